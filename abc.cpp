@@ -0,0 +1,85 @@
+/*
+Rejection ABC of the parameters of the outbreak model given observed reported counts.
+
+Arguments are name=value pairs: observed=path (a file of whitespace-separated reported
+counts per output interval), name=prior for the inferred parameters (R0 or fields of
+params_struct, with priors such as uniform:1.05:4, see inference.hpp), n_samples, n_keep,
+threshold, seed and summaries (see RejectionABC and summaries.hpp); other fields of
+params_struct as numbers, e.g. n_threads=4. Prints the kept samples and their distances.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <stdexcept>
+
+#include "inference.hpp"
+
+int main(int argc, char *argv[])
+{
+    params_struct params;
+    std::vector<std::string> names;
+    std::vector<Prior> priors;
+    std::string observed_path, summaries;
+    uint n_samples = 1000, n_keep = 100, seed = 1;
+    double threshold = INFINITY;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            size_t eq = arg.find('=');
+            std::string name = arg.substr(0, eq), value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+            if (name == "observed") observed_path = value;
+            else if (name == "summaries") summaries = value;
+            else if (name == "n_samples") n_samples = std::atoi(value.c_str());
+            else if (name == "n_keep") n_keep = std::atoi(value.c_str());
+            else if (name == "threshold") threshold = std::atof(value.c_str());
+            else if (name == "seed") seed = std::atoi(value.c_str());
+            else if (Prior::is_spec(value))
+            {
+                names.push_back(name);
+                priors.push_back(Prior(name, value));
+            }
+            else if (eq == std::string::npos || !set_param(params, name, std::atof(value.c_str())))
+            {
+                std::cerr << "Unknown parameter: " << arg << std::endl;
+                return 1;
+            }
+        }
+
+        std::ifstream file(observed_path.c_str());
+        std::vector<int> counts;
+        int count;
+        while (file >> count)
+            counts.push_back(count);
+        if (!file.eof())
+        {
+            std::cerr << "Cannot read observed counts from: " << observed_path << std::endl;
+            return 1;
+        }
+        Eigen::VectorXi observed = Eigen::Map<Eigen::VectorXi>(counts.data(), counts.size());
+
+        AbcModel model(params, names, observed, summaries);
+        RejectionABC abc(model, priors, n_samples, n_keep, threshold, seed);
+
+        for (std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it)
+            std::cout << *it << "\t";
+        std::cout << "distance" << std::endl;
+        for (uint r = 0; r < abc.samples.rows(); ++r)
+        {
+            for (uint j = 0; j < abc.samples.cols(); ++j)
+                std::cout << abc.samples(r, j) << "\t";
+            std::cout << abc.distances[r] << std::endl;
+        }
+    }
+    catch (const std::invalid_argument &error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
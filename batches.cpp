@@ -0,0 +1,127 @@
+// Contains the implementation for batches of simulations run in the background.
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+#include "batches.hpp"
+#include "inference.hpp"
+#include "outbreak.hpp"
+
+BatchQueue::BatchQueue(uint n_threads)
+    : pool(std::max(n_threads, 1u)), stopping(false), dispatcher(&BatchQueue::dispatch, this)
+{
+}
+
+BatchQueue::~BatchQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+        for (std::deque<BatchJob *>::iterator it = this->jobs.begin(); it != this->jobs.end(); ++it)
+            (*it)->token.cancel();
+    }
+    this->wake.notify_all();
+    this->dispatcher.join();
+}
+
+uint BatchQueue::n_output(const params_struct &params)
+{
+    // Return the number of counts per simulation, one per output step.
+    return lrint(1. * params.max_time / params.output_interval);
+}
+
+std::shared_future<void> BatchQueue::submit(const params_struct &params, const Eigen::VectorXd &R0, uint seed,
+                                            int *output, uint8_t *done, Progress *progress, const CancelToken *token)
+{
+    // Queue a batch and return the future of its output, without waiting.
+    if (!(R0.array() > 0.).all())
+        throw std::invalid_argument("R0 must be positive");
+    BatchJob *job = new BatchJob(token);
+    job->params = params;
+    job->params.n_threads = 0; // simulations run in parallel instead
+    job->R0 = R0;
+    job->seed = seed;
+    job->output = output;
+    job->done = done;
+    job->progress = progress;
+    if (progress != NULL)
+        progress->expect(R0.size());
+    std::shared_future<void> future = job->finished.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(job);
+    }
+    this->wake.notify_all();
+    return future;
+}
+
+size_t BatchQueue::pending()
+{
+    // Return the number of batches submitted but not finished.
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->jobs.size();
+}
+
+void BatchQueue::dispatch()
+{
+    // Loop of the dispatcher thread: run the batches in order until stopping with none left.
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true)
+    {
+        while (!this->stopping && this->jobs.empty())
+            this->wake.wait(lock);
+        if (this->jobs.empty())
+            return;
+        BatchJob *job = this->jobs.front();
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            this->run(*job);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        this->jobs.pop_front(); // not pending once its future is ready
+        if (error)
+            job->finished.set_exception(error);
+        else
+            job->finished.set_value();
+        delete job;
+    }
+}
+
+void BatchQueue::run(BatchJob &job)
+{
+    // Simulate the rows of a batch in parallel, each redrawn until "exploding", out of
+    // redraws or cancelled.
+    uint n_output = BatchQueue::n_output(job.params);
+    double mean_inf_period = job.params.infect_period_shape * job.params.infect_period_scale;
+    this->pool.parallel_for(job.R0.size(), [&](uint i) {
+        std::seed_seq seq{job.seed, i};
+        std::mt19937_64 prng(seq);
+        params_struct params = job.params;
+        params.infect_delta = mean_inf_period / job.R0[i];
+        Eigen::Map<Eigen::VectorXi> row(job.output + static_cast<size_t>(i) * n_output, n_output);
+        row.setZero();
+        job.done[i] = 0;
+        Cancellable<Silent> monitor(job.token);
+        for (uint redraw = 0; redraw < MAX_REDRAWS && !job.token.expired(); ++redraw)
+        {
+            Outbreak<std::mt19937_64, TrackCounts, Cancellable<Silent>, ReportedCounts> ob(prng, params, NULL, monitor);
+            row = ob.counters.col(0);
+            if (ob.monitor.cancelled())
+                break;
+            job.done[i] = row.cast<long>().sum() > 10 * n_output;
+            if (job.progress != NULL)
+                job.progress->outbreak(ob.n_individuals, job.done[i]);
+            if (job.done[i])
+                break;
+        }
+    });
+    if (job.progress != NULL) // those cancelled or out of redraws
+        job.progress->skip(std::count(job.done, job.done + job.R0.size(), 0));
+}
@@ -0,0 +1,116 @@
+#ifndef BATCHES_H
+#define BATCHES_H
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Eigen/Core>
+
+#include "cancel.hpp"
+#include "infectee.hpp"
+#include "outbreak.hpp"
+#include "summaries.hpp"
+#include "threadpool.hpp"
+#include "progress.hpp"
+
+// A batch of outbreaks each with an R0, whose reported counts go to `output`, a row-major
+// buffer of R0.size() rows of n_output counts, and whether each row was kept to `done`,
+// both owned by the submitter.
+struct BatchJob
+{
+    BatchJob(const CancelToken *token) : token(INFINITY, token) {}
+
+    params_struct params;
+    Eigen::VectorXd R0;
+    uint seed;
+    int *output;
+    uint8_t *done;                     // 1 for the rows kept, 0 for those cancelled or out of redraws
+    Progress *progress;                // counting the simulations, if not NULL
+    CancelToken token;                 // of the batch, expiring with the submitter's or the queue's end
+    std::promise<void> finished;       // set once the counts are written, or to the error
+};
+
+// Batches of simulations submitted without waiting for them: a dispatcher thread runs them
+// in the order submitted, spreading the simulations of a batch over a persistent pool of
+// threads. As in simulateR0, only "exploding" outbreaks are kept, here up to MAX_REDRAWS
+// redraws (see inference.hpp). Unlike there, each simulation has its own random stream from
+// the seed of the batch and its row, so that the results do not depend on the number of
+// threads. A batch stops within an output step once its token expires; rows not kept hold
+// the counts of their last run, or zeros if none was run.
+class BatchQueue
+{
+    public:
+        BatchQueue(uint n_threads);
+        ~BatchQueue();                     // Cancel the batches not finished and wait for them to stop.
+
+        // Submit a batch, returning a future set once its output is written, counting its
+        // simulations in `progress` if not NULL and cancelled with `token` if not NULL (which
+        // must outlive the batch). Throws std::invalid_argument for non-positive R0.
+        std::shared_future<void> submit(const params_struct &params, const Eigen::VectorXd &R0, uint seed, int *output,
+                                        uint8_t *done, Progress *progress = NULL, const CancelToken *token = NULL);
+        size_t pending();                  // Return the number of batches not finished.
+
+        static uint n_output(const params_struct &params); // Return the counts per simulation.
+
+    private:
+        ThreadPool pool;
+        std::deque<BatchJob *> jobs;       // submitted, the first one running
+        std::mutex mutex;
+        std::condition_variable wake;      // signals the dispatcher of new batches or stopping
+        bool stopping;
+        std::thread dispatcher;
+
+        void dispatch();                   // Loop of the dispatcher thread.
+        void run(BatchJob &job);           // Simulate a batch.
+};
+
+// summaries of a batch of simulations besides the reported counts, a row per simulation
+struct BatchStats
+{
+    RowMatrixXd R0;                   // estimate of R0 at each output step
+    RowMatrixXd case_R;               // case reproduction number per output interval
+    RowMatrixXi generation_intervals; // histograms (see CaseEstimates)
+    RowMatrixXi serial_intervals;
+};
+
+// Simulate reported counts into a row of output, and of stats if not NULL, redrawing until
+// an "exploding" run (note effect on prng) or one stopped early by the monitor (DistanceMonitor
+// only stops exploding ones). Each run starts from a copy of `monitor`, which is returned as
+// of the kept or cancelled run. Count the runs in progress if not NULL. Return false if
+// cancelled before a run was kept, leaving the counts and stats of the cancelled run.
+template <class Monitor>
+bool simulateReported(std::mt19937_64 &prng, const params_struct &params, RowMatrixXi &output, uint row,
+                      BatchStats *stats, Cancellable<Monitor> &monitor, Progress *progress)
+{
+    while (true)
+    {
+        Outbreak<std::mt19937_64, TrackCounts, Cancellable<Monitor>, ReportedCounts> ob(prng, params, NULL, monitor);
+        output.row(row) = ob.getCounters().col(0).transpose();
+        if (stats != NULL)
+        {
+            stats->R0.row(row) = ob.getR0Series().transpose();
+            stats->case_R.row(row) = ob.case_estimates.case_R().transpose();
+            stats->generation_intervals.row(row) = ob.case_estimates.generation_intervals.transpose();
+            stats->serial_intervals.row(row) = ob.case_estimates.serial_intervals.transpose();
+        }
+        if (ob.monitor.cancelled())
+        {
+            monitor = ob.monitor;
+            return false;
+        }
+
+        bool kept = ob.monitor.stop() || output.row(row).cast<long>().sum() > 10 * output.cols();
+        if (progress != NULL)
+            progress->outbreak(ob.n_individuals, kept);
+        if (kept)
+        {
+            monitor = ob.monitor;
+            return true;
+        }
+    }
+}
+
+#endif
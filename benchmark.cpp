@@ -0,0 +1,146 @@
+/*
+Benchmark the samplers of random variates against the standard library.
+
+For each distribution used by the simulation, print the time per variate, the sample
+mean and variance, and the two-sample Kolmogorov-Smirnov statistic between our
+sampler and the standard library, which should stay below the 1% critical value.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include "samplers.hpp"
+
+const uint N_DRAWS = 10000000; // for timing
+const uint N_KS = 1000000;     // for the Kolmogorov-Smirnov test
+
+// Return the time per variate in ns for N_DRAWS variates from `sample`.
+template <class Sampler>
+double time_draws(Sampler &sample, std::mt19937_64 &prng)
+{
+    double sum = 0.;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint i = 0; i < N_DRAWS; ++i)
+        sum += sample(prng);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sum == -1.) // keep the loop
+        std::cout << sum;
+    return 1e9 * elapsed / N_DRAWS;
+}
+
+// Draw N_KS sorted variates from `sample`.
+template <class Sampler>
+std::vector<double> draw_sorted(Sampler &sample, std::mt19937_64 &prng)
+{
+    std::vector<double> x(N_KS);
+    for (uint i = 0; i < N_KS; ++i)
+        x[i] = sample(prng);
+    std::sort(x.begin(), x.end());
+    return x;
+}
+
+// Return the two-sample Kolmogorov-Smirnov statistic of sorted samples of equal size.
+double ks_statistic(const std::vector<double> &x, const std::vector<double> &y)
+{
+    size_t i = 0, j = 0;
+    double d = 0.;
+    while (i < x.size() && j < y.size())
+    {
+        if (x[i] <= y[j])
+            i++;
+        else
+            j++;
+        d = std::max(d, std::fabs(1. * i - 1. * j) / x.size());
+    }
+    return d;
+}
+
+// Print a comparison of `ours` with the standard library sampler `theirs`.
+template <class Ours, class Theirs>
+void compare(const std::string &name, Ours &ours, Theirs &theirs, std::mt19937_64 &prng)
+{
+    double time_ours = time_draws(ours, prng);
+    double time_theirs = time_draws(theirs, prng);
+    std::vector<double> x = draw_sorted(ours, prng);
+    std::vector<double> y = draw_sorted(theirs, prng);
+
+    double mean = 0., var = 0.;
+    for (uint i = 0; i < N_KS; ++i)
+        mean += x[i] / N_KS;
+    for (uint i = 0; i < N_KS; ++i)
+        var += (x[i] - mean) * (x[i] - mean) / N_KS;
+
+    std::cout << std::setw(20) << name << std::setw(12) << time_ours << std::setw(12) << time_theirs
+              << std::setw(12) << mean << std::setw(12) << var
+              << std::setw(12) << ks_statistic(x, y) << std::endl;
+}
+
+// Adapt a function template to the interface of the distributions.
+struct Uniform
+{
+    double operator()(std::mt19937_64 &prng) { return uniform01(prng); }
+};
+
+struct Exponential
+{
+    double operator()(std::mt19937_64 &prng) { return exponential01(prng); }
+};
+
+struct Normal
+{
+    double operator()(std::mt19937_64 &prng) { return normal01(prng); }
+};
+
+// Draw uniforms in batches through the vectorized conversion.
+struct UniformBatch
+{
+    double buffer[1024];
+    uint next = 1024;
+    double operator()(std::mt19937_64 &prng)
+    {
+        if (this->next == 1024)
+        {
+            uniform01_batch(prng, this->buffer, 1024);
+            this->next = 0;
+        }
+        return this->buffer[this->next++];
+    }
+};
+
+int main()
+{
+    std::mt19937_64 prng(1);
+    std::cout.precision(5);
+    std::cout << "Kernels compiled for: " << kernel_isa() << std::endl;
+    std::cout << std::setw(20) << "Distribution" << std::setw(12) << "ns/draw" << std::setw(12) << "(std)"
+              << std::setw(12) << "mean" << std::setw(12) << "variance" << std::setw(12) << "KS" << std::endl;
+
+    Uniform uniform;
+    std::uniform_real_distribution<double> std_uniform(0., 1.);
+    compare("Uniform(0, 1)", uniform, std_uniform, prng);
+    UniformBatch uniform_batch;
+    compare("Uniform(0, 1) batch", uniform_batch, std_uniform, prng);
+    Exponential exponential;
+    std::exponential_distribution<double> std_exponential(1.);
+    compare("Exponential(1)", exponential, std_exponential, prng);
+    Normal normal;
+    std::normal_distribution<double> std_normal(0., 1.);
+    compare("Normal(0, 1)", normal, std_normal, prng);
+
+    const double shapes[] = {1., 2., 4., 8., 4. / 9., 2.5};
+    const double scale = 3.;
+    for (uint i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i)
+    {
+        GammaSampler gamma(shapes[i], scale);
+        std::gamma_distribution<double> std_gamma(shapes[i], scale);
+        compare("Gamma(" + std::to_string(shapes[i]).substr(0, 5) + ", 3)", gamma, std_gamma, prng);
+    }
+    std::cout << "KS critical value at 1%: " << 1.628 * sqrt(2. / N_KS) << std::endl;
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CANCEL_H
+#define CANCEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+// Cooperative cancellation of simulations, e.g. on Ctrl-C from another thread, or by a
+// wall-clock deadline. Simulations check it at their output steps (see Cancellable), so
+// they stop within an output interval of it.
+class CancelToken
+{
+    public:
+        // Expire after `seconds` (none if infinite), or with `parent` if not NULL.
+        CancelToken(double seconds = INFINITY, const CancelToken *parent = NULL)
+            : cancelled(false), parent(parent), has_deadline(std::isfinite(seconds))
+        {
+            if (this->has_deadline)
+                this->deadline = std::chrono::steady_clock::now()
+                                 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                       std::chrono::duration<double>(seconds));
+        }
+        CancelToken(const CancelToken &) = delete;
+        CancelToken &operator=(const CancelToken &) = delete;
+
+        void cancel()                      // Expire now, from any thread.
+        {
+            this->cancelled.store(true, std::memory_order_relaxed);
+        }
+        bool expired() const               // Return whether cancelled or past the deadline.
+        {
+            return this->cancelled.load(std::memory_order_relaxed)
+                   || (this->has_deadline && std::chrono::steady_clock::now() > this->deadline)
+                   || (this->parent != NULL && this->parent->expired());
+        }
+
+    private:
+        std::atomic<bool> cancelled;
+        const CancelToken *parent;
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+};
+
+#endif
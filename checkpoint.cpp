@@ -0,0 +1,124 @@
+// Contains the implementation for checkpoints of outbreaks.
+
+#include <cmath>
+#include <cstdio>
+
+#include "checkpoint.hpp"
+
+void CheckpointBuffer::put_string(const std::string &value)
+{
+    this->put<uint64_t>(value.size());
+    this->put_raw(value.data(), value.size());
+}
+
+void CheckpointBuffer::put_raw(const void *data, size_t size)
+{
+    const char *first = static_cast<const char *>(data);
+    this->bytes.insert(this->bytes.end(), first, first + size);
+}
+
+CheckpointReader::CheckpointReader(const std::string &path) : position(0)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == NULL)
+        throw std::runtime_error("Cannot open " + path);
+    bool failed = std::fseek(file, 0, SEEK_END) != 0;
+    long size = std::ftell(file);
+    failed = failed || size < 0 || std::fseek(file, 0, SEEK_SET) != 0;
+    if (!failed)
+    {
+        this->bytes.resize(size);
+        failed = std::fread(this->bytes.data(), 1, size, file) != static_cast<size_t>(size);
+    }
+    std::fclose(file);
+    if (failed)
+        throw std::runtime_error("Cannot read " + path);
+}
+
+CheckpointReader::CheckpointReader(const std::vector<char> &bytes) : bytes(bytes), position(0)
+{
+}
+
+std::string CheckpointReader::get_string()
+{
+    uint64_t n = this->get<uint64_t>();
+    std::string value(n, '\0');
+    this->get_raw(&value[0], n);
+    return value;
+}
+
+void CheckpointReader::get_raw(void *data, size_t size)
+{
+    if (size > this->bytes.size() - this->position)
+        throw std::runtime_error("Truncated checkpoint");
+    std::memcpy(data, this->bytes.data() + this->position, size);
+    this->position += size;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &path, double interval)
+    : path(path), interval(interval), next_time(interval), failed(false), n_written(0)
+{
+    if (!(interval > 0.))
+        throw std::invalid_argument("Checkpoint interval must be positive");
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    if (this->thread.joinable())
+        this->thread.join();
+}
+
+bool CheckpointWriter::due(double time)
+{
+    // Return whether a checkpoint is due at `time`, i.e. an interval has passed since the
+    // last one.
+    if (time < this->next_time - 1e-9)
+        return false;
+    this->next_time = (std::floor(time / this->interval + 1e-9) + 1.) * this->interval;
+    return true;
+}
+
+CheckpointBuffer &CheckpointWriter::buffer()
+{
+    // Return the emptied buffer for the next checkpoint, keeping its capacity.
+    this->filling.bytes.clear();
+    return this->filling;
+}
+
+void CheckpointWriter::write()
+{
+    // Start writing the buffer in the background, once the previous write is done.
+    this->wait();
+    this->writing.swap(this->filling.bytes);
+    this->n_written++;
+    this->thread = std::thread(&CheckpointWriter::write_file, this);
+}
+
+void CheckpointWriter::wait()
+{
+    // Wait for the pending write. Throws std::runtime_error if a write failed.
+    if (this->thread.joinable())
+        this->thread.join();
+    if (this->failed)
+        throw std::runtime_error("Cannot write " + this->path);
+}
+
+uint64_t CheckpointWriter::size() const
+{
+    return this->n_written;
+}
+
+void CheckpointWriter::write_file()
+{
+    // Write `writing` to a temporary file, then replace `path` by it.
+    std::string temporary = this->path + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+    bool failed = (file == NULL);
+    if (!failed)
+    {
+        failed = std::fwrite(this->writing.data(), 1, this->writing.size(), file) != this->writing.size();
+        failed = (std::fclose(file) != 0) || failed;
+    }
+    failed = failed || std::rename(temporary.c_str(), this->path.c_str()) != 0;
+    this->failed = this->failed || failed;
+}
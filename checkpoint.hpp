@@ -0,0 +1,101 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// Checkpoint of a running outbreak (see Outbreak::save): a header with the parameters
+// followed by the state, i.e. time, counters, random stream, estimates and individuals,
+// in native byte order, for restarting on the same kind of host. Values are appended one
+// after another, vectors prefixed by their size.
+
+const char CHECKPOINT_MAGIC[8] = {'O', 'B', 'C', 'H', 'E', 'C', 'K', '\0'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+// Bytes of a checkpoint being written.
+class CheckpointBuffer
+{
+    public:
+        template <class T>
+        void put(const T &value)           // Append a value of plain type.
+        {
+            this->put_raw(&value, sizeof(T));
+        }
+        template <class Vector>
+        void put_vector(const Vector &values) // Append a std::vector or Eigen vector of plain values.
+        {
+            this->put<uint64_t>(values.size());
+            this->put_raw(values.data(), values.size() * sizeof(*values.data()));
+        }
+        void put_string(const std::string &value);
+        void put_raw(const void *data, size_t size);
+
+        std::vector<char> bytes;
+};
+
+// Bytes of a checkpoint being read, from the beginning. Throws std::runtime_error when
+// reading past the end.
+class CheckpointReader
+{
+    public:
+        CheckpointReader(const std::string &path); // Read a checkpoint file.
+        CheckpointReader(const std::vector<char> &bytes);
+
+        template <class T>
+        T get()                            // Return the next value of plain type.
+        {
+            T value;
+            this->get_raw(&value, sizeof(T));
+            return value;
+        }
+        template <class Vector>
+        void get_vector(Vector &values)    // Read a vector written by put_vector.
+        {
+            uint64_t n = this->get<uint64_t>();
+            values.resize(n);
+            this->get_raw(values.data(), n * sizeof(*values.data()));
+        }
+        std::string get_string();
+        void get_raw(void *data, size_t size);
+
+    private:
+        std::vector<char> bytes;
+        size_t position;                   // of the next value
+};
+
+// Writes checkpoints to a file every `interval` of model time (see Outbreak::run). A
+// checkpoint is filled in memory by the simulation, then written in the background while
+// the simulation continues, to `path` + ".tmp" renamed to `path` once complete, so that
+// `path` always holds a complete checkpoint. A write waits for the previous one only.
+class CheckpointWriter
+{
+    public:
+        CheckpointWriter(const std::string &path, double interval);
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+        ~CheckpointWriter();               // Wait for the pending write.
+
+        bool due(double time);             // Return whether a checkpoint is due at `time`, once per interval.
+        CheckpointBuffer &buffer();        // Return the emptied buffer for the next checkpoint.
+        void write();                      // Start writing the buffer in the background.
+        void wait();                       // Wait for the pending write. Throws std::runtime_error if a write failed.
+        uint64_t size() const;             // Return the number of checkpoints written or being written.
+
+    private:
+        std::string path;
+        double interval;
+        double next_time;                  // model time of the next checkpoint
+        CheckpointBuffer filling;          // filled by the simulation
+        std::vector<char> writing;         // written by `thread`
+        std::thread thread;
+        bool failed;                       // whether a write failed, set by `thread`
+        uint64_t n_written;
+
+        void write_file();                 // Write `writing` to disk.
+};
+
+#endif
@@ -0,0 +1,230 @@
+// Contains the implementation for the compartmental approximation of an outbreak.
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdexcept>
+
+#include "compartments.hpp"
+
+Compartments::Compartments(const params_struct &params) : params(params), samplers(params)
+{
+    // The incubation factor splits the latent period into the latent state and
+    // either state 1 or 2. Their mean durations follow from the uniform distribution.
+    double a = params.incub_factor_min;
+    double b = params.incub_factor_max;
+    if (b > a)
+        this->p_symptoms_first = std::min(std::max((b - 1.) / (b - a), 0.), 1.);
+    else
+        this->p_symptoms_first = (a > 1.) ? 1. : 0.;
+    double mean_latent = params.latent_period_shape * params.latent_period_scale;
+
+    double mean_duration[N_STATES];
+    mean_duration[0] = (this->p_symptoms_first
+                        + (1. - this->p_symptoms_first) * (a + std::min(b, 1.)) / 2.) * mean_latent;
+    mean_duration[1] = ((std::max(a, 1.) + b) / 2. - 1.) * mean_latent;
+    mean_duration[2] = (1. - (a + std::min(b, 1.)) / 2.) * mean_latent;
+    // The infectious period counts from the end of latency, which symptoms may follow
+    // (see Infectee), so state 3 is shorter by state 1 then.
+    mean_duration[3] = std::max(params.infect_period_shape * params.infect_period_scale
+                                - this->p_symptoms_first * mean_duration[1], 0.);
+    mean_duration[4] = params.recover_period_shape * params.recover_period_scale;
+    mean_duration[5] = params.dying_period_shape * params.dying_period_scale;
+    mean_duration[6] = mean_duration[7] = 0.;
+
+    double shapes[N_STATES] = {params.latent_period_shape, 1., 1., params.infect_period_shape,
+                               params.recover_period_shape, params.dying_period_shape, 1., 1.};
+    uint n_total = 0;
+    for (uint s = 0; s < N_STATES; ++s)
+    {
+        // zero-length phases are passed within a single step
+        double mean = std::max(mean_duration[s], 1e-9);
+        this->parallel[s] = shapes[s] < 1.;
+        this->offset[s] = n_total;
+        if (this->parallel[s]) // squared coefficient of variation 1 / shape
+        {
+            this->n_stages[s] = 2;
+            this->p_first[s] = (1. + sqrt((1. - shapes[s]) / (1. + shapes[s]))) / 2.;
+            this->stage_mean.push_back(mean / (2. * this->p_first[s]));
+            this->stage_mean.push_back(mean / (2. * (1. - this->p_first[s])));
+        }
+        else
+        {
+            this->n_stages[s] = lrint(shapes[s]);
+            this->p_first[s] = 1.;
+            this->stage_mean.insert(this->stage_mean.end(), this->n_stages[s], mean / this->n_stages[s]);
+        }
+        n_total += this->n_stages[s];
+    }
+    this->counts = std::vector<double>(n_total, 0.);
+}
+
+template <class Rng>
+void Compartments::add(uint state, double progress, Rng &prng)
+{
+    // Add an individual `progress` (0..1) through `state`, to the stage of the progress in a
+    // chain, to either stage in parallel.
+    uint stage;
+    if (this->parallel[state])
+        stage = (uniform01(prng) < this->p_first[state]) ? 0 : 1;
+    else
+        stage = std::min(static_cast<uint>(std::max(progress, 0.) * this->n_stages[state]),
+                         this->n_stages[state] - 1);
+    this->counts[this->offset[state] + stage] += 1.;
+}
+
+template <class Rng>
+void Compartments::enter(uint state, double n, Rng &prng)
+{
+    // Add `n` individuals entering `state`, i.e. its first stage or either stage in parallel.
+    if (this->parallel[state] && n > 0.)
+    {
+        double n_first = this->draw_binomial(n, this->p_first[state], prng);
+        this->counts[this->offset[state]] += n_first;
+        this->counts[this->offset[state] + 1] += n - n_first;
+    }
+    else
+        this->counts[this->offset[state]] += n;
+}
+
+template <class Rng>
+double Compartments::draw_binomial(double n, double p, Rng &prng) const
+{
+    // Draw the number of successes, or take the expected value for large `n`.
+    if (n >= DETERMINISTIC_COUNT)
+        return n * p;
+    std::binomial_distribution<long> binomial(static_cast<long>(n), p);
+    return binomial(prng);
+}
+
+template <class Rng>
+double Compartments::step(double dt, Rng &prng)
+{
+    // Advance the counts by `dt`, returning the number of new infections. As for individuals
+    // (see Infectee::update), those infectious at any time during the step may infect.
+    std::vector<double> outflow(this->counts.size(), 0.);
+    double n_infectious = 0.;
+    for (uint s = 0; s < 6; ++s)
+    {
+        for (uint i = this->offset[s]; i < this->offset[s] + this->n_stages[s]; ++i)
+        {
+            if (s == 2 || s == 3)
+                n_infectious += this->counts[i];
+            if (this->counts[i] > 0.)
+                outflow[i] = this->draw_binomial(this->counts[i], 1. - exp(-dt / this->stage_mean[i]), prng);
+        }
+    }
+
+    // states that follow after the last stage of each state, or after either in parallel
+    for (uint s = 0; s < 6; ++s)
+    {
+        uint last = this->offset[s] + this->n_stages[s] - 1;
+        double out = 0.;
+        for (uint i = this->offset[s]; i <= last; ++i)
+        {
+            this->counts[i] -= outflow[i];
+            if (i == last || this->parallel[s])
+                out += outflow[i];
+            else
+                this->counts[i + 1] += outflow[i];
+        }
+        if (s == 0)
+        {
+            double n_symptoms_first = this->draw_binomial(out, this->p_symptoms_first, prng);
+            this->enter(1, n_symptoms_first, prng);
+            this->enter(2, out - n_symptoms_first, prng);
+            n_infectious += out - n_symptoms_first;
+        }
+        else if (s == 1 || s == 2)
+        {
+            this->enter(3, out, prng);
+            if (s == 1)
+                n_infectious += out;
+        }
+        else if (s == 3)
+        {
+            double n_recovering = this->draw_binomial(out, this->params.p_recovery, prng);
+            this->enter(4, n_recovering, prng);
+            this->enter(5, out - n_recovering, prng);
+        }
+        else
+            this->enter(s + 2, out, prng);
+    }
+
+    double n_new = n_infectious * dt / this->params.infect_delta;
+    if (n_new < DETERMINISTIC_COUNT)
+    {
+        std::poisson_distribution<long> poisson(n_new);
+        n_new = (n_new > 0.) ? poisson(prng) : 0.;
+    }
+    this->enter(0, n_new, prng);
+    return n_new;
+}
+
+template <class Rng>
+std::vector<Infectee *> Compartments::release(double time, Rng &prng)
+{
+    // Convert active counts to individuals, leaving only the recovered and dead.
+    // The remaining time in a state is the sum of the remaining exponential stages, or
+    // that of the stage in parallel.
+    std::vector<Infectee *> released;
+    for (uint s = 0; s < 6; ++s)
+    {
+        for (uint j = 0; j < this->n_stages[s]; ++j)
+        {
+            double &count = this->counts[this->offset[s] + j];
+            long n = static_cast<long>(count);
+            if (uniform01(prng) < count - n)
+                n++;
+            uint n_remaining = this->parallel[s] ? 1 : this->n_stages[s] - j;
+            GammaSampler gamma_remaining(n_remaining, this->stage_mean[this->offset[s] + j]);
+            for (long k = 0; k < n; ++k)
+                released.push_back(new Infectee(s, time, gamma_remaining(prng), prng, this->samplers));
+            count = 0.;
+        }
+    }
+    return released;
+}
+
+void Compartments::save(CheckpointBuffer &out) const
+{
+    // Write the counts to a checkpoint; the stages follow from the parameters.
+    out.put_vector(this->counts);
+}
+
+void Compartments::load(CheckpointReader &in)
+{
+    // Read the counts written by save with the same parameters.
+    std::vector<double> counts;
+    in.get_vector(counts);
+    if (counts.size() != this->counts.size())
+        throw std::runtime_error("Checkpoint of other compartments");
+    this->counts.swap(counts);
+}
+
+double Compartments::n_active() const
+{
+    // Return the number of individuals not recovered nor dead.
+    double n = 0.;
+    for (uint i = 0; i < this->offset[6]; ++i)
+        n += this->counts[i];
+    return n;
+}
+
+Eigen::ArrayXd Compartments::state_counts() const
+{
+    // Return the number of individuals in each state.
+    Eigen::ArrayXd state_counts = Eigen::ArrayXd::Zero(N_STATES);
+    for (uint s = 0; s < N_STATES; ++s)
+        for (uint i = this->offset[s]; i < this->offset[s] + this->n_stages[s]; ++i)
+            state_counts[s] += this->counts[i];
+    return state_counts;
+}
+
+// random-number generators available for Outbreak
+template void Compartments::add(uint, double, std::mt19937_64 &);
+template void Compartments::add(uint, double, std::mt19937 &);
+template double Compartments::step(double, std::mt19937_64 &);
+template std::vector<Infectee *> Compartments::release(double, std::mt19937_64 &);
+template double Compartments::step(double, std::mt19937 &);
+template std::vector<Infectee *> Compartments::release(double, std::mt19937 &);
@@ -0,0 +1,55 @@
+#ifndef COMPARTMENTS_H
+#define COMPARTMENTS_H
+
+#include <random>
+#include <vector>
+#include <Eigen/Core>
+
+#include "infectee.hpp"
+
+// Counts above which flows between compartments are taken as their expected values.
+const double DETERMINISTIC_COUNT = 1e6;
+
+// Compartmental approximation of the infection progression for large outbreaks.
+// Each gamma-distributed phase is replaced by a chain of exponential stages with the
+// same mean (linear chain trick), the number of stages being the rounded shape. Phases
+// with shape below 1 are replaced by two exponential stages in parallel instead
+// (hyperexponential with balanced means), matching their mean and variance.
+// Counts are advanced by tau-leaping with binomial flows and Poisson infections,
+// turning deterministic for counts above DETERMINISTIC_COUNT.
+class Compartments
+{
+    public:
+        Compartments(const params_struct &params);
+
+        template <class Rng>
+        void add(uint state, double progress, Rng &prng); // Add an individual `progress` (0..1) through `state`.
+        template <class Rng>
+        double step(double dt, Rng &prng);     // Advance the counts by `dt`, returning the new infections.
+        template <class Rng>
+        std::vector<Infectee *> release(double time, Rng &prng); // Convert active counts to individuals.
+
+        void save(CheckpointBuffer &out) const; // Write the counts to a checkpoint.
+        void load(CheckpointReader &in);        // Read the counts written by save.
+
+        double n_active() const;               // Return the number of individuals not recovered nor dead.
+        Eigen::ArrayXd state_counts() const;   // Return the number of individuals in each state.
+
+    private:
+        params_struct params;
+        Samplers samplers;             // for released individuals
+        std::vector<double> counts;    // individuals per stage, stages of state s at offset[s]
+        uint n_stages[N_STATES];       // number of stages per state
+        uint offset[N_STATES];         // index to the first stage of each state
+        bool parallel[N_STATES];       // whether the two stages of a state are in parallel
+        double p_first[N_STATES];      // probability of entering the first of parallel stages
+        std::vector<double> stage_mean; // mean duration per stage
+        double p_symptoms_first;       // probability of symptoms before infectiousness
+
+        template <class Rng>
+        double draw_binomial(double n, double p, Rng &prng) const;
+        template <class Rng>
+        void enter(uint state, double n, Rng &prng); // Add `n` individuals entering `state`.
+};
+
+#endif
@@ -0,0 +1,45 @@
+// Contains the implementation for the distance to observed counts.
+
+#include <stdexcept>
+
+#include "distance.hpp"
+
+Distance::Distance(const Eigen::VectorXd &observed, const Eigen::VectorXd &weights, const Eigen::VectorXd &scales,
+                   double threshold)
+    : threshold(threshold), observed(observed)
+{
+    // Empty weights and scales stand for ones.
+    uint n = observed.size();
+    if ((weights.size() > 0 && weights.size() != n) || (scales.size() > 0 && scales.size() != n))
+        throw std::invalid_argument("Weights and scales must be as long as the observed series");
+    this->factors = (weights.size() > 0) ? weights : Eigen::VectorXd::Ones(n);
+    if (scales.size() > 0)
+        this->factors = this->factors.cwiseQuotient(scales.cwiseAbs2());
+}
+
+double Distance::term(uint step, double count) const
+{
+    // Return the term of the sum at output `step`.
+    double diff = count - this->observed[step];
+    return this->factors[step] * diff * diff;
+}
+
+double Distance::operator()(const Eigen::VectorXi &counts) const
+{
+    // Return the distance of `counts` (at least as long as the observed series).
+    Eigen::ArrayXd diff = counts.head(this->size()).cast<double>() - this->observed;
+    return std::sqrt((this->factors.array() * diff.square()).sum());
+}
+
+double Distance::of_values(const Eigen::VectorXd &values) const
+{
+    // Return the distance of `values` (at least as long as the observed series).
+    Eigen::ArrayXd diff = values.head(this->size()).array() - this->observed.array();
+    return std::sqrt((this->factors.array() * diff.square()).sum());
+}
+
+uint Distance::size() const
+{
+    // Return the length of the observed series.
+    return this->observed.size();
+}
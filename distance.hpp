@@ -0,0 +1,75 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <cmath>
+#include <string>
+#include <Eigen/Core>
+
+typedef unsigned int uint;
+
+// Weighted Euclidean distance of reported counts to an observed series,
+//   sqrt(sum_i weights[i] * ((counts[i] - observed[i]) / scales[i])^2),
+// over the output steps of the observed series. As the sum only grows with each output
+// step, a simulation can be stopped once its partial distance exceeds `threshold`.
+class Distance
+{
+    public:
+        Distance(const Eigen::VectorXd &observed, const Eigen::VectorXd &weights = Eigen::VectorXd(),
+                 const Eigen::VectorXd &scales = Eigen::VectorXd(), double threshold = INFINITY);
+
+        double term(uint step, double count) const; // Return the term of the sum at output `step`.
+        double operator()(const Eigen::VectorXi &counts) const; // Return the distance of `counts`.
+        double of_values(const Eigen::VectorXd &values) const; // Return the distance of `values`, e.g. summaries.
+        uint size() const;                 // Return the length of the observed series.
+
+        double threshold;                  // distance above which a simulation is hopeless
+
+    private:
+        Eigen::VectorXd observed;
+        Eigen::VectorXd factors;           // weights / scales^2
+};
+
+// Monitor of Outbreak (see outbreak.hpp) accumulating the distance of the reported counts
+// (ReportedCounts) and stopping once it exceeds the threshold. Only runs whose counts so far
+// add up to more than `exploding` are stopped, i.e. those that would be kept rather than
+// redrawn as dying out (see simulateR0), so that stopping does not change which runs are
+// kept. Observed rows not output, as after a run ended early, count as zeros like the rest
+// of the counters.
+class DistanceMonitor
+{
+    public:
+        static const bool verbose = false;
+
+        DistanceMonitor(const Distance &distance, double exploding)
+            : distance(&distance), exploding(exploding), sum(0.), total(0.), n_rows(0) {}
+
+        void output(double, const Eigen::MatrixXi &counters, uint row)
+        {
+            if (row < this->distance->size())
+                this->sum += this->distance->term(row, counters(row, 0));
+            this->total += counters(row, 0);
+            this->n_rows = row + 1;
+        }
+        void message(const std::string &) {}
+        bool stop() const
+        {
+            return this->total > this->exploding && std::sqrt(this->sum) > this->distance->threshold;
+        }
+
+        double value() const               // Return the distance, as Distance of the counters.
+        {
+            double sum = this->sum;
+            for (uint row = this->n_rows; row < this->distance->size(); ++row)
+                sum += this->distance->term(row, 0.);
+            return std::sqrt(sum);
+        }
+
+    private:
+        const Distance *distance;
+        double exploding;                  // total of the counts above which runs may be stopped
+        double sum;                        // sum of the terms so far
+        double total;                      // total of the counts so far
+        uint n_rows;                       // number of rows output so far
+};
+
+#endif
@@ -0,0 +1,181 @@
+// Contains the implementation for replicates of an outbreak advanced in lockstep.
+
+#include <algorithm>
+#include <math.h>
+#include <limits>
+
+#include "ensemble.hpp"
+#include "kernels.hpp"
+
+// Return the state in `phase` of the trajectory {0, symptom, 3, outcome, outcome + 2}.
+static inline uint8_t trajectory_state(uint8_t phase, uint8_t symptom, uint8_t outcome)
+{
+    static const uint8_t fixed[] = {0, 0, 3, 0, 2};
+    return fixed[phase] + (phase == 1) * symptom + (phase >= 3) * outcome;
+}
+
+Ensemble::Ensemble(std::mt19937_64 &prng, const params_struct &params, const std::vector<double> &infect_delta,
+                   const CancelToken *token)
+    : cancelled(false), params(params), samplers(params), n_replicates(infect_delta.size())
+{
+    uint n_output = lrint(1. * params.max_time / params.output_interval);
+    this->counters = Eigen::MatrixXi::Zero(this->n_replicates, n_output);
+    this->occupancy = Eigen::MatrixXi::Zero(this->n_replicates, N_STATES);
+    this->running = Eigen::VectorXi::Ones(this->n_replicates);
+    this->n_infected.assign(this->n_replicates, 1);
+    for (uint32_t k = 0; k < this->n_replicates; ++k)
+    {
+        this->p_infect.push_back(params.timestep / infect_delta[k]);
+        this->add(k, 0, prng);
+    }
+    uint output_counter = 0;
+
+    double time = params.timestep;
+    while (time <= params.max_time)
+    {
+        bool is_output_step = std::fmod(time + 1e-9, params.output_interval) < params.timestep;
+
+        this->step(time, prng);
+
+        if (is_output_step) // all but the latent states are reported, for all replicates at once
+        {
+            Eigen::VectorXi reported = this->occupancy.rowwise().sum() - this->occupancy.col(0) - this->occupancy.col(2);
+            this->counters.col(output_counter) += reported.cwiseProduct(this->running);
+            output_counter++;
+            if (token != NULL && token->expired())
+            {
+                this->cancelled = true;
+                break;
+            }
+        }
+
+        // append all new infectees from time step
+        for (std::vector<uint32_t>::iterator it = this->births.begin(); it != this->births.end(); ++it)
+        {
+            this->add(*it, time, prng);
+            this->n_infected[*it]++;
+        }
+
+        for (uint32_t k = 0; k < this->n_replicates; ++k)
+            if (this->n_infected[k] > params.max_infected)
+                this->running[k] = 0;
+
+        this->compact();
+        time += params.timestep;
+    }
+}
+
+void Ensemble::add(uint32_t k, double infection_time, std::mt19937_64 &prng)
+{
+    // Add an infectee to replicate `k`, drawing its trajectory as in Infectee.
+    double latent_period = this->samplers.latent_period(prng);
+    double incubation_factor = this->samplers.incub_factor_min
+                               + (this->samplers.incub_factor_max - this->samplers.incub_factor_min) * uniform01(prng);
+    double infectious_period = this->samplers.infect_period(prng);
+    bool recovers = uniform01(prng) < this->samplers.p_recovery;
+    double outcome_period = recovers ? this->samplers.recover_period(prng) : this->samplers.dying_period(prng);
+
+    // incubation time may differ from latent time
+    double two_periods = latent_period + infectious_period;
+    if (incubation_factor > 1.)
+    {
+        this->symptom.push_back(1);
+        this->ends.push_back(infection_time + latent_period);
+        this->ends.push_back(infection_time + incubation_factor * latent_period);
+    }
+    else
+    { // symptoms after infectious
+        this->symptom.push_back(2);
+        this->ends.push_back(infection_time + incubation_factor * latent_period);
+        this->ends.push_back(infection_time + latent_period);
+    }
+    this->ends.push_back(infection_time + two_periods);
+    this->ends.push_back(infection_time + two_periods + outcome_period);
+
+    this->outcome.push_back(recovers ? 4 : 5);
+    this->replicate.push_back(k);
+    this->phase.push_back(0);
+    this->state.push_back(0);
+    this->next_end.push_back(this->ends[this->ends.size() - 4]);
+    this->occupancy(k, 0)++;
+}
+
+void Ensemble::step(double time, std::mt19937_64 &prng)
+{
+    // Advance all replicates to `time`, collecting the replicates of new infectees in `births`.
+    size_t n = this->state.size();
+    this->due.resize(n);
+    this->infectious.resize(n);
+    kernel_mark_due(this->next_end.data(), n, time, this->due.data());
+    kernel_mark_infectious(this->state.data(), n, this->infectious.data());
+
+    // few individuals change phase per step
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!this->due[i])
+            continue;
+        uint32_t k = this->replicate[i];
+        this->occupancy(k, this->state[i])--;
+        while (time >= this->next_end[i])
+        {
+            this->phase[i]++;
+            this->state[i] = trajectory_state(this->phase[i], this->symptom[i], this->outcome[i]);
+            this->infectious[i] |= (this->state[i] == 2) || (this->state[i] == 3);
+            this->next_end[i] = (this->phase[i] < 4) ? this->ends[4 * i + this->phase[i]]
+                                                     : std::numeric_limits<double>::infinity();
+        }
+        this->occupancy(k, this->state[i])++;
+    }
+
+    // Bernoulli draws of all infectious individuals, each with the p_infect of its replicate
+    this->infectors.clear();
+    this->groups.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (this->infectious[i])
+        {
+            this->infectors.push_back(i);
+            this->groups.push_back(this->replicate[i]);
+        }
+    }
+    size_t m = this->infectors.size();
+    this->uniforms.resize(m);
+    this->hits.resize(m);
+    uniform01_batch(prng, this->uniforms.data(), m);
+    kernel_mark_below(this->uniforms.data(), this->groups.data(), this->p_infect.data(), m, this->hits.data());
+
+    this->births.clear();
+    for (size_t j = 0; j < m; ++j)
+        if (this->hits[j])
+            this->births.push_back(this->groups[j]);
+}
+
+void Ensemble::compact()
+{
+    // Drop recovered or dead individuals and those of stopped replicates.
+    size_t n = this->state.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (this->state[i] > 5 || !this->running[this->replicate[i]])
+            continue;
+        if (kept != i)
+        {
+            this->replicate[kept] = this->replicate[i];
+            this->phase[kept] = this->phase[i];
+            this->state[kept] = this->state[i];
+            this->symptom[kept] = this->symptom[i];
+            this->outcome[kept] = this->outcome[i];
+            std::copy(this->ends.begin() + 4 * i, this->ends.begin() + 4 * i + 4, this->ends.begin() + 4 * kept);
+            this->next_end[kept] = this->next_end[i];
+        }
+        kept++;
+    }
+    this->replicate.resize(kept);
+    this->phase.resize(kept);
+    this->state.resize(kept);
+    this->symptom.resize(kept);
+    this->outcome.resize(kept);
+    this->ends.resize(4 * kept);
+    this->next_end.resize(kept);
+}
@@ -0,0 +1,60 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <random>
+#include <vector>
+#include <stdint.h>
+#include <Eigen/Core>
+
+#include "infectee.hpp"
+#include "cancel.hpp"
+
+// Several replicates of an outbreak advanced in lockstep, differing only in infect_delta.
+// The individuals of all replicates are kept in flat arrays (structure of arrays), so that
+// the phase checks and the Bernoulli infection draws of a time step are single loops over
+// all replicates (see kernels.hpp), and the reported counts of all replicates are updated
+// at once from per-replicate state occupancies. Meant for batches of small to medium
+// outbreaks, for which one Outbreak per replicate is dominated by per-individual overhead.
+// Equivalent in distribution to Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts>
+// (the random streams differ); no tree, tau-leaping nor hybrid simulation. All replicates
+// stop at the output step at which `token` (if not NULL) has expired.
+class Ensemble
+{
+    public:
+        Ensemble(std::mt19937_64 &prng, const params_struct &params, const std::vector<double> &infect_delta,
+                 const CancelToken *token = NULL);
+
+        Eigen::MatrixXi counters;          // reported counts per replicate (rows) and output interval
+        std::vector<uint> n_infected;      // number of individuals infected so far per replicate
+        bool cancelled;                    // whether stopped by the token
+
+    private:
+        params_struct params;              // user-given parameters (defaults in infectee.hpp)
+        Samplers samplers;                 // random distributions set up from params
+        uint n_replicates;
+        std::vector<double> p_infect;      // probability of infecting per time step per replicate
+        Eigen::VectorXi running;           // 1, or 0 once max_infected is exceeded
+        Eigen::MatrixXi occupancy;         // individuals in each state (columns) per replicate, incl. past
+
+        // individuals not yet recovered nor dead, of all replicates
+        std::vector<uint32_t> replicate;   // replicate of each individual
+        std::vector<uint8_t> phase;        // index to the trajectory {0, symptom, 3, outcome, outcome + 2}
+        std::vector<uint8_t> state;        // current state
+        std::vector<uint8_t> symptom;      // 1 (symptoms before infectious) or 2
+        std::vector<uint8_t> outcome;      // 4 (recovering) or 5 (dying)
+        std::vector<double> ends;          // end times of the four phases, four per individual
+        std::vector<double> next_end;      // end time of the current phase
+
+        // scratch space for a time step
+        std::vector<uint8_t> due, infectious;
+        std::vector<uint32_t> infectors, groups;
+        std::vector<double> uniforms;
+        std::vector<uint8_t> hits;
+        std::vector<uint32_t> births;
+
+        void add(uint32_t k, double infection_time, std::mt19937_64 &prng); // Add an infectee to replicate k.
+        void step(double time, std::mt19937_64 &prng);                     // Advance all replicates to `time`.
+        void compact();                    // Drop recovered or dead individuals and stopped replicates.
+};
+
+#endif
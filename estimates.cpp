@@ -0,0 +1,164 @@
+// Contains the implementation for estimates maintained during a run.
+
+#include <algorithm>
+#include <cmath>
+
+#include "estimates.hpp"
+
+R0Estimate::R0Estimate(const params_struct &params)
+    : timestep(params.timestep), next_step(0), n_infectors(0), n_reported(0)
+{
+    uint n_steps = std::ceil(params.max_time / params.timestep) + 2;
+    this->infectors.assign(n_steps, 0);
+    this->reported.assign(n_steps, 0);
+}
+
+double R0Estimate::step(double time) const
+{
+    // Return the time step of an event at `time`, the first one at or after it.
+    return std::ceil(time / this->timestep - 1e-9);
+}
+
+void R0Estimate::schedule(std::vector<uint> &events, double time)
+{
+    // Add an event at `time` to its time step, dropping it past the end.
+    double step = this->step(time);
+    if (step < events.size())
+        events[std::max(step, 0.)]++;
+}
+
+void R0Estimate::add(double infectious_end, double reported, double infector_infectious_end)
+{
+    // Schedule the events of an infectee: the end of its infectious period and, if it has
+    // an infector (infector_infectious_end not NaN), its report counted once both have passed.
+    this->schedule(this->infectors, infectious_end);
+    if (!std::isnan(infector_infectious_end))
+        this->schedule(this->reported, std::max(reported, infector_infectious_end));
+}
+
+void R0Estimate::withdraw(double infectious_end, double reported, double infector_infectious_end)
+{
+    // Unschedule the events of an infectee added before that are not counted yet: the end of
+    // its infectious period and its report if that of its infector is not counted yet either,
+    // i.e. the infector is withdrawn too.
+    double end = this->step(infectious_end);
+    if (end >= this->next_step && end < this->infectors.size())
+        this->infectors[end]--;
+    if (!std::isnan(infector_infectious_end) && this->step(infector_infectious_end) >= this->next_step)
+    {
+        double report = this->step(std::max(reported, infector_infectious_end));
+        if (report < this->reported.size())
+            this->reported[report]--;
+    }
+}
+
+void R0Estimate::advance(double time)
+{
+    // Count the events up to `time`.
+    uint last = std::min<double>(lrint(time / this->timestep), this->infectors.size() - 1.);
+    for (; this->next_step <= last; ++this->next_step)
+    {
+        this->n_infectors += this->infectors[this->next_step];
+        this->n_reported += this->reported[this->next_step];
+    }
+}
+
+double R0Estimate::value() const
+{
+    // Return the estimate (NaN without infectors).
+    return (this->n_infectors > 0) ? (1. * this->n_reported) / this->n_infectors : std::nan("");
+}
+
+void R0Estimate::save(CheckpointBuffer &out) const
+{
+    out.put_vector(this->infectors);
+    out.put_vector(this->reported);
+    out.put(this->next_step);
+    out.put(this->n_infectors);
+    out.put(this->n_reported);
+}
+
+void R0Estimate::load(CheckpointReader &in)
+{
+    in.get_vector(this->infectors);
+    in.get_vector(this->reported);
+    this->next_step = in.get<uint>();
+    this->n_infectors = in.get<uint64_t>();
+    this->n_reported = in.get<uint64_t>();
+}
+
+CaseEstimates::CaseEstimates(const params_struct &params)
+    : output_interval(params.output_interval), histogram_bin(params.histogram_bin)
+{
+    uint n_output = lrint(1. * params.max_time / params.output_interval);
+    uint n_bins = std::ceil(params.max_time / params.histogram_bin);
+    this->infected = Eigen::VectorXi::Zero(n_output);
+    this->infectees = Eigen::VectorXi::Zero(n_output);
+    this->excluded = Eigen::VectorXi::Zero(n_output);
+    this->generation_intervals = Eigen::VectorXi::Zero(n_bins);
+    this->serial_intervals = Eigen::VectorXi::Zero(2 * n_bins);
+}
+
+uint CaseEstimates::interval(double time) const
+{
+    // Return the output interval of `time`, the last one for later times.
+    return std::min<double>(std::floor(time / this->output_interval), this->infected.size() - 1.);
+}
+
+double CaseEstimates::bin(double interval) const
+{
+    // Return the histogram bin of `interval` from 0, counting intervals on a bin edge up to
+    // rounding (e.g. 0.3 / 0.1) in the bin above it.
+    return std::floor(interval / this->histogram_bin + 1e-9);
+}
+
+void CaseEstimates::add(double infection_time, double reported, double infector_infection_time, double infector_reported)
+{
+    // Count an infectee, with the times of its infector NaN if it has none. Intervals
+    // outside the histograms are counted in the first or last bin.
+    this->infected[this->interval(infection_time)]++;
+    if (std::isnan(infector_infection_time))
+        return;
+    this->infectees[this->interval(infector_infection_time)]++;
+
+    double n_bins = this->generation_intervals.size();
+    double generation = this->bin(infection_time - infector_infection_time);
+    this->generation_intervals[std::min(std::max(generation, 0.), n_bins - 1)]++;
+    double serial = this->bin(reported - infector_reported) + n_bins;
+    this->serial_intervals[std::min(std::max(serial, 0.), 2 * n_bins - 1)]++;
+}
+
+void CaseEstimates::exclude(uint interval)
+{
+    if (interval < this->excluded.size())
+        this->excluded[interval] = 1;
+}
+
+Eigen::VectorXd CaseEstimates::case_R() const
+{
+    // Return the case reproduction number per output interval (NaN without cases or
+    // excluded).
+    Eigen::VectorXd R = this->infectees.cast<double>().cwiseQuotient(this->infected.cast<double>());
+    for (uint i = 0; i < R.size(); ++i)
+        if (this->infected[i] == 0 || this->excluded[i])
+            R[i] = std::nan("");
+    return R;
+}
+
+void CaseEstimates::save(CheckpointBuffer &out) const
+{
+    out.put_vector(this->infected);
+    out.put_vector(this->infectees);
+    out.put_vector(this->excluded);
+    out.put_vector(this->generation_intervals);
+    out.put_vector(this->serial_intervals);
+}
+
+void CaseEstimates::load(CheckpointReader &in)
+{
+    in.get_vector(this->infected);
+    in.get_vector(this->infectees);
+    in.get_vector(this->excluded);
+    in.get_vector(this->generation_intervals);
+    in.get_vector(this->serial_intervals);
+}
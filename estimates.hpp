@@ -0,0 +1,76 @@
+#ifndef ESTIMATES_H
+#define ESTIMATES_H
+
+#include <vector>
+#include <stdint.h>
+#include <Eigen/Core>
+
+#include "infectee.hpp"
+
+// Estimate of the basic reproduction number maintained during a run: the number of
+// reported infectees of the infectors past their infectious period, per such infector.
+// The events counted, the end of the infectious period of an individual and the report
+// of an infectee once its infector is counted, are known when the infectee is infected.
+// They are binned by time step then and summed up as time passes, so the estimate is
+// available at each step without going through the population. Infectors leaving for the
+// compartmental approximation before the end of their infectious period are withdrawn with
+// their infectees, as their later infectees are not known.
+class R0Estimate
+{
+    public:
+        R0Estimate(const params_struct &params);
+
+        void add(double infectious_end, double reported, double infector_infectious_end); // Schedule the events of an infectee.
+        void withdraw(double infectious_end, double reported, double infector_infectious_end); // Unschedule those not counted yet.
+        void advance(double time);         // Count the events up to `time`.
+        double value() const;              // Return the estimate (NaN without infectors).
+        void save(CheckpointBuffer &out) const; // Write the state to a checkpoint.
+        void load(CheckpointReader &in);   // Read the state written by save.
+
+    private:
+        double timestep;
+        std::vector<uint> infectors;       // infectors past their infectious period per time step
+        std::vector<uint> reported;        // counted reported infectees per time step
+        uint next_step;                    // first time step not counted yet
+        uint64_t n_infectors;
+        uint64_t n_reported;
+
+        double step(double time) const;    // Return the time step of an event at `time`.
+        void schedule(std::vector<uint> &events, double time); // Add an event at `time` to its time step.
+};
+
+// Case reproduction numbers, i.e. the mean number of infectees of the individuals infected
+// in each output interval, and histograms of the generation intervals (between infections)
+// and serial intervals (between reports) of infectors and infectees, accumulated as
+// individuals are infected. The intervals take the times drawn at infection, also those
+// after the end of the run; the case reproduction numbers of the last intervals lack the
+// infections after the end of the run, and those before a switch to the compartmental
+// approximation the infections in it. Intervals not followed individually (e.g. in the
+// compartmental approximation) are excluded.
+class CaseEstimates
+{
+    public:
+        CaseEstimates(const params_struct &params);
+
+        void add(double infection_time, double reported, double infector_infection_time, double infector_reported); // Count an infectee.
+        void exclude(uint interval);       // Exclude an output interval from case_R.
+        Eigen::VectorXd case_R() const;    // Return the case reproduction number per output interval (NaN without cases).
+        void save(CheckpointBuffer &out) const; // Write the state to a checkpoint.
+        void load(CheckpointReader &in);   // Read the state written by save.
+
+        Eigen::VectorXi generation_intervals; // bin i counts intervals in [i, i + 1) * params.histogram_bin
+        Eigen::VectorXi serial_intervals;  // bin i counts intervals in [i - n, i - n + 1) * params.histogram_bin,
+                                           // where n = generation_intervals.size()
+
+    private:
+        double output_interval;
+        double histogram_bin;
+        Eigen::VectorXi infected;          // individuals infected per output interval
+        Eigen::VectorXi infectees;         // their infectees
+        Eigen::VectorXi excluded;          // 1 for excluded intervals
+
+        uint interval(double time) const;  // Return the output interval of `time`.
+        double bin(double interval) const; // Return the histogram bin of `interval` from 0.
+};
+
+#endif
@@ -1,30 +1,37 @@
 // Contains the implementation for an infected individual.
 
+#include <algorithm>
 #include <iostream>
 #include <math.h>
 #include <random>
 
 #include "infectee.hpp"
 
-Infectee::Infectee(Infectee *infector, double infection_time, std::mt19937_64 &prng, params_struct params) : infector(infector), infection_time(infection_time)
+Samplers::Samplers(const params_struct &params)
+    : latent_period(params.latent_period_shape, params.latent_period_scale),
+      incub_factor_min(params.incub_factor_min), incub_factor_max(params.incub_factor_max),
+      infect_period(params.infect_period_shape, params.infect_period_scale),
+      p_recovery(params.p_recovery),
+      recover_period(params.recover_period_shape, params.recover_period_scale),
+      dying_period(params.dying_period_shape, params.dying_period_scale),
+      p_infect(params.timestep / params.infect_delta)
 {
+}
 
-    // setup random distributions
-    std::gamma_distribution<double> gamma_latent_period(params.latent_period_shape,
-                                                        params.latent_period_scale);
-    std::uniform_real_distribution<double> unif_incub_factor(params.incub_factor_min,
-                                                             params.incub_factor_max);
-    std::gamma_distribution<double> gamma_infect_period(params.infect_period_shape,
-                                                        params.infect_period_scale);
-    std::bernoulli_distribution will_recover(params.p_recovery);
-    this->rInfect = std::bernoulli_distribution(params.timestep / params.infect_delta);
-
+template <class Rng>
+Infectee::Infectee(Infectee *infector, double infection_time, Rng &prng, const Samplers &samplers)
+    : infector(infector), infection_time(infection_time), id(0), infector_id(infector ? infector->id : NO_INFECTOR),
+      infector_infection_time(infector && !infector->released ? infector->infection_time : std::nan("")),
+      infector_reported(infector && !infector->released ? infector->time_reported() : std::nan("")),
+      infector_infectious_end(infector && !infector->released ? infector->time_infectious_over() : std::nan(""))
+{
     // In the following several lines, set future evolution steps of the infection
     this->status_trajectory.push_back(0);
     this->end_times = Eigen::ArrayXd(N_STATES);
     this->end_times = std::nan("1."); // default times NaNs
-    double latent_period = gamma_latent_period(prng);
-    double incubation_factor = unif_incub_factor(prng);
+    double latent_period = samplers.latent_period(prng);
+    double incubation_factor = samplers.incub_factor_min
+                               + (samplers.incub_factor_max - samplers.incub_factor_min) * uniform01(prng);
 
     // incubation time may differ from latent time
     if (incubation_factor > 1.)
@@ -41,27 +48,23 @@ Infectee::Infectee(Infectee *infector, double infection_time, std::mt19937_64 &p
     }
 
     this->status_trajectory.push_back(3);
-    double infectious_period = gamma_infect_period(prng);
+    double infectious_period = samplers.infect_period(prng);
     double two_periods = latent_period + infectious_period;
     this->end_times[3] = two_periods;
 
     double time_end;
-    if (will_recover(prng))
+    if (uniform01(prng) < samplers.p_recovery)
     {
         this->status_trajectory.push_back(4);
         this->status_trajectory.push_back(6);
-        std::gamma_distribution<double> gamma_recover_period(params.recover_period_shape,
-                                                             params.recover_period_scale);
-        double recover_period = gamma_recover_period(prng);
+        double recover_period = samplers.recover_period(prng);
         time_end = two_periods + recover_period;
     }
     else
     {
         this->status_trajectory.push_back(5);
         this->status_trajectory.push_back(7);
-        std::gamma_distribution<double> gamma_dying_period(params.dying_period_shape,
-                                                           params.dying_period_scale);
-        double dying_period = gamma_dying_period(prng);
+        double dying_period = samplers.dying_period(prng);
         time_end = two_periods + dying_period;
     }
     this->end_times[this->status_trajectory[3]] = time_end;
@@ -69,77 +72,163 @@ Infectee::Infectee(Infectee *infector, double infection_time, std::mt19937_64 &p
 
     this->status_iter = this->status_trajectory.begin();
     this->time_last_infection = std::nan("1.");
+    this->shared = false;
+    this->released = false;
 }
 
-Infectee::~Infectee()
+template <class Rng>
+Infectee::Infectee(uint state, double time, double remaining, Rng &prng, const Samplers &samplers)
+    : infector(NULL), infection_time(time), id(0), infector_id(NO_INFECTOR), infector_infection_time(std::nan("")),
+      infector_reported(std::nan("")), infector_infectious_end(std::nan(""))
 {
-    // std::cout << "Infectee destroyed" << std::endl;
-}
+    // Continue an infection that was not followed individually so far (e.g. one released
+    // from the compartmental approximation), currently in `state` for `remaining` time.
+    // The earlier phases are given zero length, the later ones are drawn as usual.
+    double latent_period = samplers.latent_period(prng);
+    double incubation_factor = samplers.incub_factor_min
+                               + (samplers.incub_factor_max - samplers.incub_factor_min) * uniform01(prng);
+    uint symptom_state = (incubation_factor > 1.) ? 1 : 2;
+    if (state == 1 || state == 2)
+        symptom_state = state;
+
+    bool recovers = (state == 4) || (state != 5 && uniform01(prng) < samplers.p_recovery);
+    uint outcome_state = recovers ? 4 : 5;
+
+    double durations[N_STATES];
+    durations[0] = std::min(incubation_factor, 1.) * latent_period;
+    durations[symptom_state] = std::fabs(incubation_factor - 1.) * latent_period;
+    durations[3] = samplers.infect_period(prng);
+    durations[outcome_state] = recovers ? samplers.recover_period(prng) : samplers.dying_period(prng);
+
+    uint trajectory[] = {0, symptom_state, 3, outcome_state, outcome_state + 2};
+    this->end_times = Eigen::ArrayXd(N_STATES);
+    this->end_times = std::nan("1.");
+    uint current = 0;
+    bool started = false;
+    double time_end = time;
+    for (uint i = 0; i < 4; ++i)
+    {
+        this->status_trajectory.push_back(trajectory[i]);
+        if (trajectory[i] == state)
+        {
+            current = i;
+            started = true;
+            time_end += remaining;
+        }
+        else if (started)  // phases after the current one
+            time_end += durations[trajectory[i]];
+        this->end_times[trajectory[i]] = time_end;
+    }
+    this->status_trajectory.push_back(trajectory[4]);
 
-Infectee *Infectee::infect(Infectee *other)
-{
-    // Mark `other` as infected by self.
-    this->infected.push_back(other);
-    return other;
+    this->status_iter = this->status_trajectory.begin() + current;
+    this->time_last_infection = std::nan("1.");
+    this->shared = false;
+    this->released = true;
 }
 
-int Infectee::n_infected() const
+Infectee::Infectee(const Infectee &other)
+    : infector(other.infector), infection_time(other.infection_time), id(other.id), infector_id(other.infector_id),
+      infector_infection_time(other.infector_infection_time), infector_reported(other.infector_reported),
+      infector_infectious_end(other.infector_infectious_end), infected(other.infected),
+      status_trajectory(other.status_trajectory), end_times(other.end_times),
+      time_last_infection(other.time_last_infection), shared(false), released(other.released)
 {
-    // Return the number of infected by self.
-    return this->infected.size();
+    // Copy `other` (e.g. for a copy of an outbreak), at the same phase of infection.
+    // `infector` and `infected` still point to the individuals of `other`.
+    this->status_iter = this->status_trajectory.begin() + (other.status_iter - other.status_trajectory.begin());
 }
 
-int Infectee::istatus() const
+Infectee::Infectee(CheckpointReader &in)
+    : infector(NULL), infection_time(in.get<double>()), id(in.get<uint>()), infector_id(in.get<uint>()),
+      infector_infection_time(in.get<double>()), infector_reported(in.get<double>()),
+      infector_infectious_end(in.get<double>())
 {
-    // Return the index to current status;
-    return *(this->status_iter);
+    // Read an individual written by save, in the order of declaration. `infector` and
+    // `infected` are set by the outbreak read.
+    in.get_vector(this->status_trajectory);
+    in.get_vector(this->end_times);
+    this->status_iter = this->status_trajectory.begin() + in.get<uint32_t>();
+    this->time_last_infection = in.get<double>();
+    this->shared = false;
+    this->released = in.get<bool>();
 }
 
-std::string Infectee::status() const
+void Infectee::save(CheckpointBuffer &out) const
 {
-    // Return current status from the State enum.
-    return States[this->istatus()];
+    // Write self to a checkpoint, without `infector` and `infected` (given by infector_id).
+    out.put(this->infection_time);
+    out.put(this->id);
+    out.put(this->infector_id);
+    out.put(this->infector_infection_time);
+    out.put(this->infector_reported);
+    out.put(this->infector_infectious_end);
+    out.put_vector(this->status_trajectory);
+    out.put_vector(this->end_times);
+    out.put<uint32_t>(this->status_iter - this->status_trajectory.begin());
+    out.put(this->time_last_infection);
+    out.put(this->released);
 }
 
-bool Infectee::can_infect() const
+Infectee::~Infectee()
 {
-    // Return whether self can infect others.
-    return (this->istatus() == 2) || (this->istatus() == 3);
+    // std::cout << "Infectee destroyed" << std::endl;
 }
 
-bool Infectee::is_reported() const
+int Infectee::n_infected() const
 {
-    // Return whether infection has been reported (i.e. not latent).
-    return (this->istatus() > 2) || (this->istatus() == 1);
+    // Return the number of infected by self.
+    return this->infected.size();
 }
 
-double Infectee::time_next() const
+std::string Infectee::status() const
 {
-    // Return time of next phase in infection.
-    return this->end_times[this->istatus()];
+    // Return current status from the State enum.
+    return States[this->istatus()];
 }
 
-std::vector<Infectee *> Infectee::update(double time, std::mt19937_64 &prng, params_struct params)
+double Infectee::progress(double time) const
 {
-    // Depending on time, update status of infection and possibly infect someone.
-    std::vector<Infectee *> new_infected;  // Currently size<=1
-
-    bool infectious = this->can_infect();
+    // Return the fraction of current phase passed at `time`.
+    double time_start = this->infection_time;
+    if (this->status_iter != this->status_trajectory.begin())
+        time_start = this->end_times[*(this->status_iter - 1)];
+    double duration = this->time_next() - time_start;
+    return (duration > 0.) ? (time - time_start) / duration : 0.;
+}
 
-    while (time >= this->time_next())
-    {
-        this->status_iter++;
-        infectious = infectious || this->can_infect();
-    }
+// random-number generators available for Outbreak
+template Infectee::Infectee(Infectee *, double, std::mt19937_64 &, const Samplers &);
+template Infectee::Infectee(uint, double, double, std::mt19937_64 &, const Samplers &);
+template Infectee::Infectee(Infectee *, double, std::mt19937 &, const Samplers &);
+template Infectee::Infectee(uint, double, double, std::mt19937 &, const Samplers &);
 
-    if (infectious)
-    {
-        if (this->rInfect(prng))
-        {
-            this->time_last_infection = time;
-            new_infected.push_back(this->infect(new Infectee(this, time, prng, params)));
-        }
-    }
-
-    return new_infected;
+bool set_param(params_struct &params, const std::string &name, double value)
+{
+    // Set a field of `params` by name. Return false if there is no such field.
+    if (name == "latent_period_shape") params.latent_period_shape = value;
+    else if (name == "latent_period_scale") params.latent_period_scale = value;
+    else if (name == "incub_factor_min") params.incub_factor_min = value;
+    else if (name == "incub_factor_max") params.incub_factor_max = value;
+    else if (name == "infect_period_shape") params.infect_period_shape = value;
+    else if (name == "infect_period_scale") params.infect_period_scale = value;
+    else if (name == "p_recovery") params.p_recovery = value;
+    else if (name == "recover_period_shape") params.recover_period_shape = value;
+    else if (name == "recover_period_scale") params.recover_period_scale = value;
+    else if (name == "dying_period_shape") params.dying_period_shape = value;
+    else if (name == "dying_period_scale") params.dying_period_scale = value;
+    else if (name == "infect_delta") params.infect_delta = value;
+    else if (name == "max_time") params.max_time = value;
+    else if (name == "output_interval") params.output_interval = value;
+    else if (name == "histogram_bin") params.histogram_bin = value;
+    else if (name == "timestep") params.timestep = value;
+    else if (name == "max_infected") params.max_infected = static_cast<uint>(value);
+    else if (name == "hybrid_threshold") params.hybrid_threshold = static_cast<uint>(value);
+    else if (name == "tau_leap") params.tau_leap = (value != 0.);
+    else if (name == "n_threads") params.n_threads = static_cast<uint>(value);
+    else if (name == "ensemble") params.ensemble = static_cast<uint>(value);
+    else if (name == "track_tree") params.track_tree = (value != 0.);
+    else if (name == "verbose") params.verbose = (value != 0.);
+    else return false;
+    return true;
 }
@@ -1,11 +1,16 @@
 #ifndef INFECTEE_H
 #define INFECTEE_H
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 #include <random>
 #include <vector>
 #include <Eigen/Core>
 
+#include "samplers.hpp"
+#include "checkpoint.hpp"
+
 typedef unsigned int uint;
 
 const uint N_STATES = 8; // number of different infection statuses
@@ -28,9 +33,33 @@ struct params_struct
     double infect_delta = 2.941; // avg time between infections
     double max_time = 364.;           // max model time (e.g. days)
     double output_interval = 7.;    // interval of output (e.g. week)
+    double histogram_bin = 1.;      // bin width of generation and serial interval histograms (e.g. day)
     double timestep = 0.2;
-    uint max_infected = 100000;  // stop iterating if reached
-    bool verbose = false;  // true for printing progress etc.
+    uint max_infected = 100000;  // stop iterating if reached, counting individuals outside compartments
+    uint hybrid_threshold = 0;   // switch to compartmental model above this many active infectees (0: never)
+    bool tau_leap = false;       // true for drawing the number of infections per time step at once
+    uint n_threads = 0;          // threads stepping chunks of individuals (0: serial; equal results for any n > 0)
+    uint ensemble = 0;           // replicates advanced in lockstep by simulateR0 (0: one Outbreak at a time)
+    bool track_tree = true;      // false for keeping only counts instead of who infected whom (*)
+    bool verbose = false;  // true for printing progress etc. (*)
+};
+// (*) fixed at compile time by the policies of Outbreak, used for choosing among them
+
+bool set_param(params_struct &params, const std::string &name, double value); // Set a field by name.
+
+// Random distributions of the progression of an infection, set up once per outbreak.
+struct Samplers
+{
+    Samplers(const params_struct &params);
+
+    GammaSampler latent_period;
+    double incub_factor_min;
+    double incub_factor_max;
+    GammaSampler infect_period;
+    double p_recovery;
+    GammaSampler recover_period;
+    GammaSampler dying_period;
+    double p_infect;                // probability of infecting per time step
 };
 
 // Infection states (ref. Infection.istatus)
@@ -44,21 +73,44 @@ const std::string States[N_STATES]{
     "recovered",
     "dead"};
 
+const uint NO_INFECTOR = UINT_MAX; // infector id of individuals infected from outside
+
+template <class Rng, class Tracking, class Monitor, class Output> class Outbreak;
+
 class Infectee
 {
     public:
-        Infectee(Infectee *infector, double infection_time, std::mt19937_64 &prng, params_struct params);
+        template <class Rng>
+        Infectee(Infectee *infector, double infection_time, Rng &prng, const Samplers &samplers);
+        template <class Rng>
+        Infectee(uint state, double time, double remaining, Rng &prng, const Samplers &samplers);
+        Infectee(const Infectee &other);
+        Infectee(CheckpointReader &in);    // Read an individual written by save.
         ~Infectee();
 
         bool can_infect() const;           // Return whether self can infect others.
         bool is_reported() const;          // Return whether infection has been reported.
+        bool is_over() const;              // Return whether infection has ended (recovered or dead).
+        double time_reported() const;      // Return the time from which infection is reported.
+        double time_infectious_over() const; // Return the time from which the infectious period is over.
+        double time_infected() const;      // Return the time of infection.
+        uint get_id() const;               // Return the number in order of infection.
+        uint get_infector_id() const;      // Return the id of the infector or NO_INFECTOR.
         std::string status() const;        // Return current status from the State enum.
 
-        std::vector<Infectee *> update(double time, std::mt19937_64 &prng, params_struct params); // Depending on time, update status of infection and possibly infect someone.
+        template <bool track_tree, class Rng>
+        Infectee *update(double time, Rng &prng, const Samplers &samplers); // Depending on time, update status of infection and possibly infect someone.
+        bool advance(double time);         // Update status of infection to time and return whether infectious meanwhile.
+        void save(CheckpointBuffer &out) const; // Write self to a checkpoint, without `infector` and `infected`.
 
     private:
-        const Infectee *infector;          // The individual who caused infection.
+        const Infectee *infector;          // The individual who caused infection, if the tree is tracked.
         const double infection_time;       // Time of infection.
+        uint id;                           // Number in order of infection (set by Outbreak).
+        const uint infector_id;            // Id of `infector` or NO_INFECTOR, also if not tracked.
+        const double infector_infection_time; // Time of infection of `infector` or NaN.
+        const double infector_reported;    // Time from which `infector` is reported or NaN.
+        const double infector_infectious_end; // End of the infectious period of `infector` or NaN.
 
         Infectee *infect(Infectee *other); // Mark `other` as infected by self.
         std::vector<Infectee *> infected;  // Individuals infected by self.
@@ -70,24 +122,125 @@ class Infectee
 
         int istatus() const;               // Return the index to current status;
         double time_next() const;          // Return time of next phase in infection.
+        double progress(double time) const; // Return the fraction of current phase passed at `time`.
         double time_last_infection;        // Time of latest infection by self.
+        bool shared;                       // Whether shared by copies of an outbreak, hence unchanging.
+        bool released;                     // Whether continued from the compartmental approximation, with
+                                           // the times before unknown (its infectees count as without infector).
 
-        std::bernoulli_distribution rInfect;  // random engine for infecting
-
-    friend class Outbreak;
+    template <class Rng, class Tracking, class Monitor, class Output> friend class Outbreak;
+    friend class LineListWriter;
     friend std::ostream &operator<<(std::ostream &os, Infectee const &inf);
 };
 
+// The following are called for each individual at each time step, hence inline.
+
+inline Infectee *Infectee::infect(Infectee *other)
+{
+    // Mark `other` as infected by self.
+    this->infected.push_back(other);
+    return other;
+}
+
+inline int Infectee::istatus() const
+{
+    // Return the index to current status;
+    return *(this->status_iter);
+}
+
+inline bool Infectee::can_infect() const
+{
+    // Return whether self can infect others.
+    return (this->istatus() == 2) || (this->istatus() == 3);
+}
+
+inline bool Infectee::is_reported() const
+{
+    // Return whether infection has been reported (i.e. not latent).
+    return (this->istatus() > 2) || (this->istatus() == 1);
+}
+
+inline bool Infectee::is_over() const
+{
+    // Return whether infection has ended (recovered or dead).
+    return this->istatus() > 5;
+}
+
+inline double Infectee::time_reported() const
+{
+    // Return the time from which infection is reported (i.e. the end of latency or of
+    // being infectious before symptoms).
+    return this->end_times[(this->status_trajectory[1] == 1) ? 0 : 2];
+}
+
+inline double Infectee::time_infectious_over() const
+{
+    // Return the time from which the infectious period is over (symptoms may show only
+    // after the infectious period, which then ends with them).
+    return std::max(this->end_times[this->status_trajectory[1]], this->end_times[3]);
+}
+
+inline double Infectee::time_infected() const
+{
+    // Return the time of infection.
+    return this->infection_time;
+}
+
+inline uint Infectee::get_id() const
+{
+    // Return the number in order of infection (set by Outbreak).
+    return this->id;
+}
+
+inline uint Infectee::get_infector_id() const
+{
+    // Return the id of the infector or NO_INFECTOR, also if the tree is not tracked.
+    return this->infector_id;
+}
+
+inline double Infectee::time_next() const
+{
+    // Return time of next phase in infection.
+    return this->end_times[this->istatus()];
+}
+
+inline bool Infectee::advance(double time)
+{
+    // Update status of infection to `time` and return whether infectious meanwhile.
+    bool infectious = this->can_infect();
+
+    while (time >= this->time_next())
+    {
+        this->status_iter++;
+        infectious = infectious || this->can_infect();
+    }
+    return infectious;
+}
+
+template <bool track_tree, class Rng>
+inline Infectee *Infectee::update(double time, Rng &prng, const Samplers &samplers)
+{
+    // Depending on time, update status of infection and possibly infect someone.
+    // Return the new infectee or NULL.
+    if (this->advance(time) && uniform01(prng) < samplers.p_infect)
+    {
+        this->time_last_infection = time;
+        Infectee *other = new Infectee(this, time, prng, samplers);
+        if (track_tree)
+            return this->infect(other);
+        other->infector = NULL; // not kept alive
+        return other;
+    }
+    return NULL;
+}
+
 // Allow printing a representation of Infectee objects
 inline std::ostream &operator<<(std::ostream &os, Infectee const &inf)
 {
-    os << "Individual " << &inf << " was infected at t=" << inf.infection_time;
+    os << "Individual " << inf.id << " was infected at t=" << inf.infection_time;
     os << " and has infected " << inf.n_infected() << " others: ";
     for (int i = 0; i < inf.n_infected(); ++i)
-    {
-        os << ' ' << inf.infected[i];
-        os.flush();
-    }
+        os << ' ' << inf.infected[i]->id;
     return os;
 }
 
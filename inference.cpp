@@ -0,0 +1,663 @@
+// Contains the implementation for inference of the parameters: ABC and particle methods.
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <Eigen/Cholesky>
+
+#include "inference.hpp"
+#include "outbreak.hpp"
+#include "threadpool.hpp"
+
+const uint ABC_BLOCK_SIZE = 256; // samples between updates of the early stopping bound
+
+typedef Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> FilteredOutbreak;
+
+static params_struct with_values(const params_struct &params, const std::vector<std::string> &names,
+                                 const double *values)
+{
+    // Return params with the parameters `names` (R0 or fields) set to `values`, which must be
+    // in_support.
+    params_struct result = params;
+    double R0 = NAN;
+    for (uint j = 0; j < names.size(); ++j)
+    {
+        if (names[j] == "R0")
+            R0 = values[j];
+        else
+            set_param(result, names[j], values[j]);
+    }
+    if (!std::isnan(R0)) // after the infectious period
+        result.infect_delta = result.infect_period_shape * result.infect_period_scale / R0;
+    return result;
+}
+
+static bool in_support(const std::vector<std::string> &names, const double *values)
+{
+    // Return whether `values` of the parameters `names` can be simulated, i.e. R0 is
+    // positive, as draws from priors and proposals need not be.
+    for (uint j = 0; j < names.size(); ++j)
+        if (names[j] == "R0" && !(values[j] > 0.))
+            return false;
+    return true;
+}
+
+static void systematic_resample(const Eigen::VectorXd &weights, std::mt19937_64 &prng, std::vector<uint> &ancestors)
+{
+    // Set `ancestors` to the indices resampled systematically by the normalized `weights`:
+    // n evenly spaced points over the cumulative weights.
+    uint n = weights.size();
+    ancestors.resize(n);
+    double step = 1. / n;
+    double point = step * uniform01(prng);
+    double cumulative = weights[0];
+    uint k = 0;
+    for (uint i = 0; i < n; ++i, point += step)
+    {
+        while (point > cumulative && k < n - 1)
+            cumulative += weights[++k];
+        ancestors[i] = k;
+    }
+}
+
+static bool parse_spec(const std::string &spec, std::string &kind, std::vector<double> &args)
+{
+    // Split a spec such as "uniform:1.05:4" into its kind and colon-separated numbers.
+    // Return false if an argument is not a number.
+    size_t colon = spec.find(':');
+    kind = spec.substr(0, colon);
+    args.clear();
+    while (colon != std::string::npos)
+    {
+        size_t next = spec.find(':', colon + 1);
+        std::string arg = spec.substr(colon + 1, next == std::string::npos ? std::string::npos : next - colon - 1);
+        char *end;
+        args.push_back(std::strtod(arg.c_str(), &end));
+        if (arg.empty() || *end != '\0')
+            return false;
+        colon = next;
+    }
+    return true;
+}
+
+Prior::Prior(const std::string &name, const std::string &spec) : name(name)
+{
+    // Parse the kind and its colon-separated arguments.
+    std::string kind;
+    std::vector<double> args;
+    if (!parse_spec(spec, kind, args))
+        throw std::invalid_argument("Bad argument of prior " + name + ": " + spec);
+
+    size_t n_args;
+    if (kind == "uniform") { this->kind = UNIFORM; n_args = 2; }
+    else if (kind == "normal") { this->kind = NORMAL; n_args = 2; }
+    else if (kind == "truncnorm") { this->kind = TRUNCNORM; n_args = 4; }
+    else if (kind == "lognormal") { this->kind = LOGNORMAL; n_args = 2; }
+    else throw std::invalid_argument("Unknown prior of " + name + ": " + spec);
+    if (args.size() != n_args)
+        throw std::invalid_argument("Wrong number of arguments of prior " + name + ": " + spec);
+    if ((this->kind == UNIFORM && !(args[0] < args[1])) || (this->kind != UNIFORM && !(args[1] > 0.))
+        || (this->kind == TRUNCNORM && !(args[2] < args[3])))
+        throw std::invalid_argument("Empty or degenerate prior of " + name + ": " + spec);
+    std::copy(args.begin(), args.end(), this->args);
+}
+
+double Prior::operator()(std::mt19937_64 &prng) const
+{
+    // Return a value drawn from the prior.
+    switch (this->kind)
+    {
+        case UNIFORM:
+            return this->args[0] + (this->args[1] - this->args[0]) * uniform01(prng);
+        case NORMAL:
+            return this->args[0] + this->args[1] * normal01(prng);
+        case TRUNCNORM:
+            while (true) // by rejection, for bounds not far in the tails
+            {
+                double x = this->args[0] + this->args[1] * normal01(prng);
+                if (x >= this->args[2] && x <= this->args[3])
+                    return x;
+            }
+        default:
+            return std::exp(this->args[0] + this->args[1] * normal01(prng));
+    }
+}
+
+double Prior::density(double x) const
+{
+    // Return the density at x, up to a factor constant in x.
+    double z = (this->kind == LOGNORMAL) ? (std::log(x) - this->args[0]) / this->args[1]
+                                         : (x - this->args[0]) / this->args[1];
+    switch (this->kind)
+    {
+        case UNIFORM:
+            return (x >= this->args[0] && x <= this->args[1]) ? 1. / (this->args[1] - this->args[0]) : 0.;
+        case NORMAL:
+            return std::exp(-0.5 * z * z) / this->args[1];
+        case TRUNCNORM:
+            return (x >= this->args[2] && x <= this->args[3]) ? std::exp(-0.5 * z * z) / this->args[1] : 0.;
+        default:
+            return (x > 0.) ? std::exp(-0.5 * z * z) / (this->args[1] * x) : 0.;
+    }
+}
+
+bool Prior::is_spec(const std::string &spec)
+{
+    // Return whether `spec` looks like a prior rather than a number.
+    return spec.find(':') != std::string::npos;
+}
+
+AbcModel::AbcModel(const params_struct &params, const std::vector<std::string> &names, const Eigen::VectorXi &observed,
+                   const std::string &summaries, const Eigen::VectorXd &weights, const Eigen::VectorXd &scales)
+    : params(params), names(names), n_observed(observed.size()), use_summaries(!summaries.empty()),
+      kernels(summaries, observed.size()), to_observed(Eigen::VectorXd(observed.cast<double>()))
+{
+    this->n_threads = params.n_threads;
+    this->params.n_threads = 0; // simulations run in parallel instead
+    this->n_output = lrint(1. * params.max_time / params.output_interval);
+    if (observed.size() == 0 || observed.size() > this->n_output)
+        throw std::invalid_argument("Observed series empty or longer than the simulated one");
+
+    params_struct copy = params;
+    for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+        if (*it != "R0" && !set_param(copy, *it, 0.))
+            throw std::invalid_argument("Unknown parameter: " + *it);
+
+    if (this->use_summaries)
+    {
+        RowMatrixXd stats;
+        this->kernels.compute(RowMatrixXi(observed.transpose()), stats);
+        this->to_observed = Distance(stats.row(0).transpose(), weights, scales);
+    }
+    else
+        this->to_observed = Distance(observed.cast<double>(), weights, scales);
+}
+
+// token of inference without one, never expiring
+static const CancelToken NO_TOKEN;
+
+double AbcModel::distance(const double *values, std::mt19937_64 &prng, double threshold,
+                          const CancelToken *token) const
+{
+    // Return the distance of a simulation with the parameters `values` (as names), or one
+    // above threshold if stopped early, or infinity if none of MAX_REDRAWS was "exploding",
+    // the values are out of the support or `token` expired.
+    if (!in_support(this->names, values))
+        return INFINITY;
+    params_struct params = with_values(this->params, this->names, values);
+    const CancelToken &cancel = (token != NULL) ? *token : NO_TOKEN;
+
+    if (!this->use_summaries)
+    {
+        Distance bounded = this->to_observed;
+        bounded.threshold = threshold;
+        for (uint k = 0; k < MAX_REDRAWS; ++k)
+        {
+            // stopping only exploding ones
+            Cancellable<DistanceMonitor> monitor(cancel, DistanceMonitor(bounded, 10. * this->n_output));
+            Outbreak<std::mt19937_64, TrackCounts, Cancellable<DistanceMonitor>, ReportedCounts> ob(prng, params, NULL,
+                                                                                                    monitor);
+            if (ob.monitor.cancelled())
+                return INFINITY;
+            if (ob.monitor.stop() || ob.getCounters().cast<long>().sum() > 10 * this->n_output)
+                return ob.monitor.value();
+        }
+    }
+    else
+    {
+        for (uint k = 0; k < MAX_REDRAWS; ++k)
+        {
+            Outbreak<std::mt19937_64, TrackCounts, Cancellable<Silent>, ReportedCounts> ob(prng, params, NULL,
+                                                                                           Cancellable<Silent>(cancel));
+            if (ob.monitor.cancelled())
+                return INFINITY;
+            Eigen::MatrixXi counters = ob.getCounters();
+            if (counters.cast<long>().sum() > 10 * this->n_output)
+            {
+                RowMatrixXd stats;
+                this->kernels.compute(RowMatrixXi(counters.col(0).head(this->n_observed).transpose()), stats);
+                return this->to_observed.of_values(stats.row(0).transpose());
+            }
+        }
+    }
+    return INFINITY;
+}
+
+// a kept sample, ordered by distance for a max-heap
+struct AbcSample
+{
+    double distance;
+    std::vector<double> values;
+
+    bool operator<(const AbcSample &other) const
+    {
+        return this->distance < other.distance;
+    }
+};
+
+RejectionABC::RejectionABC(const AbcModel &model, const std::vector<Prior> &priors, uint n_samples, uint n_keep,
+                           double threshold, uint seed, const CancelToken *token)
+{
+    uint n_params = priors.size();
+    if (n_params != model.names.size())
+        throw std::invalid_argument("A prior is needed for each parameter");
+    ThreadPool pool(std::max(model.n_threads, 1u));
+
+    std::vector<AbcSample> kept; // max-heap by distance
+    std::vector<double> values(ABC_BLOCK_SIZE * n_params);
+    std::vector<double> block_distances(ABC_BLOCK_SIZE);
+    for (uint first = 0; first < n_samples && !(token != NULL && token->expired()); first += ABC_BLOCK_SIZE)
+    {
+        uint n = std::min(ABC_BLOCK_SIZE, n_samples - first);
+        // bound fixed for the block, so that results do not depend on the scheduling
+        double bound = (n_keep > 0 && kept.size() == n_keep) ? std::min(threshold, kept.front().distance) : threshold;
+
+        pool.parallel_for(n, [&](uint i) {
+            std::seed_seq seq{seed, first + i};
+            std::mt19937_64 prng(seq);
+            double *sample = &values[i * n_params];
+            for (uint j = 0; j < n_params; ++j)
+                sample[j] = priors[j](prng);
+            block_distances[i] = model.distance(sample, prng, bound, token);
+        });
+
+        for (uint i = 0; i < n; ++i)
+        {
+            double distance = block_distances[i];
+            if (!(distance <= threshold) || (n_keep > 0 && kept.size() == n_keep && !(distance < kept.front().distance)))
+                continue;
+            if (n_keep > 0 && kept.size() == n_keep)
+            {
+                std::pop_heap(kept.begin(), kept.end());
+                kept.pop_back();
+            }
+            AbcSample accepted = {distance, std::vector<double>(values.begin() + i * n_params,
+                                                                values.begin() + (i + 1) * n_params)};
+            kept.push_back(accepted);
+            std::push_heap(kept.begin(), kept.end());
+        }
+    }
+
+    std::sort_heap(kept.begin(), kept.end());
+    this->samples.resize(kept.size(), n_params);
+    this->distances.resize(kept.size());
+    for (uint r = 0; r < kept.size(); ++r)
+    {
+        this->distances[r] = kept[r].distance;
+        for (uint j = 0; j < n_params; ++j)
+            this->samples(r, j) = kept[r].values[j];
+    }
+}
+
+AbcSMC::AbcSMC(const AbcModel &model, const std::vector<Prior> &priors, const smc_struct &settings, uint seed,
+               const CancelToken *token)
+    : n_simulations(0)
+{
+    uint n = settings.n_particles;
+    uint n_params = priors.size();
+    if (n_params != model.names.size())
+        throw std::invalid_argument("A prior is needed for each parameter");
+    if (n < 2)
+        throw std::invalid_argument("At least two particles are needed");
+    ThreadPool pool(std::max(model.n_threads, 1u));
+    std::vector<uint> attempts(n);
+
+    // first round from the priors
+    this->particles.resize(n, n_params);
+    this->distances.resize(n);
+    pool.parallel_for(n, [&](uint i) {
+        std::seed_seq seq{seed, 0u, i};
+        std::mt19937_64 prng(seq);
+        std::vector<double> x(n_params);
+        for (attempts[i] = 1; ; ++attempts[i])
+        {
+            for (uint j = 0; j < n_params; ++j)
+                x[j] = priors[j](prng);
+            double distance = model.distance(x.data(), prng, INFINITY, token);
+            if (distance < INFINITY || attempts[i] == settings.max_attempts || (token != NULL && token->expired()))
+            {
+                this->distances[i] = distance;
+                break;
+            }
+        }
+        for (uint j = 0; j < n_params; ++j)
+            this->particles(i, j) = x[j];
+    });
+    for (uint i = 0; i < n; ++i)
+        this->n_simulations += attempts[i];
+    this->weights = Eigen::VectorXd::Constant(n, 1. / n);
+    this->thresholds.push_back(INFINITY);
+    this->ess.push_back(n);
+
+    for (uint round = 1; round < settings.n_rounds && !(token != NULL && token->expired()); ++round)
+    {
+        // threshold: weighted quantile of the distances
+        std::vector<uint> order(n);
+        for (uint i = 0; i < n; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this](uint a, uint b) {
+            return this->distances[a] < this->distances[b];
+        });
+        double cumulative = 0.;
+        double threshold = INFINITY;
+        for (std::vector<uint>::iterator it = order.begin(); it != order.end(); ++it)
+        {
+            cumulative += this->weights[*it];
+            if (cumulative >= settings.quantile)
+            {
+                threshold = std::max(this->distances[*it], settings.min_threshold);
+                break;
+            }
+        }
+        if (!(threshold < this->thresholds.back()))
+            break;
+
+        // Gaussian kernel with twice the weighted covariance
+        Eigen::RowVectorXd mean = this->weights.transpose() * this->particles;
+        Eigen::MatrixXd centered = this->particles.rowwise() - mean;
+        Eigen::MatrixXd covariance = 2. * centered.transpose() * this->weights.asDiagonal() * centered;
+        Eigen::LLT<Eigen::MatrixXd> llt(covariance);
+        if (llt.info() != Eigen::Success)
+            break;
+        Eigen::MatrixXd L = llt.matrixL();
+        std::vector<double> cumulative_weights(n);
+        std::partial_sum(this->weights.data(), this->weights.data() + n, cumulative_weights.begin());
+
+        // new particles from the previous ones perturbed, within threshold
+        Eigen::MatrixXd proposed(n, n_params);
+        Eigen::VectorXd proposed_distances(n);
+        std::vector<uint> simulated(n, 0);
+        pool.parallel_for(n, [&](uint i) {
+            std::seed_seq seq{seed, round, i};
+            std::mt19937_64 prng(seq);
+            Eigen::VectorXd z(n_params), x(n_params);
+            proposed_distances[i] = INFINITY;
+            for (attempts[i] = 1; attempts[i] <= settings.max_attempts && !(token != NULL && token->expired());
+                 ++attempts[i])
+            {
+                double u = uniform01(prng) * cumulative_weights.back();
+                uint ancestor = std::min<size_t>(std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), u)
+                                                 - cumulative_weights.begin(), n - 1);
+                for (uint j = 0; j < n_params; ++j)
+                    z[j] = normal01(prng);
+                x = this->particles.row(ancestor).transpose() + L * z;
+                if (this->prior_density(x.data(), priors) == 0.)
+                    continue;
+                simulated[i]++;
+                double distance = model.distance(x.data(), prng, threshold, token);
+                if (distance <= threshold)
+                {
+                    proposed.row(i) = x.transpose();
+                    proposed_distances[i] = distance;
+                    break;
+                }
+            }
+        });
+        bool complete = true;
+        for (uint i = 0; i < n; ++i)
+        {
+            this->n_simulations += simulated[i];
+            complete &= (proposed_distances[i] <= threshold);
+        }
+        if (!complete)
+            break;
+
+        // importance weights: prior / kernel mixture density, with the kernel's Mahalanobis distances
+        Eigen::MatrixXd old_scaled = L.triangularView<Eigen::Lower>().solve(this->particles.transpose());
+        Eigen::MatrixXd new_scaled = L.triangularView<Eigen::Lower>().solve(proposed.transpose());
+        Eigen::VectorXd new_weights(n);
+        pool.parallel_for(n, [&](uint i) {
+            Eigen::VectorXd squared = (old_scaled.colwise() - new_scaled.col(i)).colwise().squaredNorm().transpose();
+            double mixture = this->weights.dot((-0.5 * squared.array()).exp().matrix());
+            Eigen::VectorXd x = proposed.row(i).transpose();
+            new_weights[i] = this->prior_density(x.data(), priors) / mixture;
+        });
+        // proposals far from all previous particles have an underflowing mixture
+        for (uint i = 0; i < n; ++i)
+            if (!std::isfinite(new_weights[i]))
+                new_weights[i] = 0.;
+        if (!(new_weights.sum() > 0.))
+            break;
+
+        this->particles = proposed;
+        this->distances = proposed_distances;
+        this->weights = new_weights / new_weights.sum();
+        this->thresholds.push_back(threshold);
+        this->ess.push_back(1. / this->weights.squaredNorm());
+        if (this->ess.back() < settings.ess_fraction * n)
+        {
+            std::seed_seq seq{seed, round, n};
+            std::mt19937_64 prng(seq);
+            this->resample(prng);
+        }
+        if (threshold <= settings.min_threshold)
+            break;
+    }
+}
+
+double AbcSMC::prior_density(const double *x, const std::vector<Prior> &priors) const
+{
+    // Return the joint prior density (of independent parameters) at x.
+    double density = 1.;
+    for (uint j = 0; j < priors.size(); ++j)
+        density *= priors[j].density(x[j]);
+    return density;
+}
+
+void AbcSMC::resample(std::mt19937_64 &prng)
+{
+    // Resample systematically to equal weights.
+    uint n = this->weights.size();
+    std::vector<uint> ancestors;
+    systematic_resample(this->weights, prng, ancestors);
+    Eigen::MatrixXd particles(n, this->particles.cols());
+    Eigen::VectorXd distances(n);
+    for (uint i = 0; i < n; ++i)
+    {
+        particles.row(i) = this->particles.row(ancestors[i]);
+        distances[i] = this->distances[ancestors[i]];
+    }
+    this->particles = particles;
+    this->distances = distances;
+    this->weights = Eigen::VectorXd::Constant(n, 1. / n);
+}
+
+Reporting::Reporting(const std::string &spec)
+{
+    // Parse the kind and its colon-separated arguments.
+    std::string kind;
+    std::vector<double> args;
+    if (spec.empty())
+        throw std::invalid_argument("A reporting spec is needed");
+    if (!parse_spec(spec, kind, args))
+        throw std::invalid_argument("Bad argument of reporting: " + spec);
+
+    if (kind == "binomial" && args.size() == 1) { this->kind = BINOMIAL; this->size = 0.; }
+    else if (kind == "negbinomial" && args.size() == 2) { this->kind = NEGBINOMIAL; this->size = args[1]; }
+    else throw std::invalid_argument("Unknown reporting: " + spec);
+    this->p = args[0];
+    if (!(this->p > 0. && this->p <= 1.) || (this->kind == NEGBINOMIAL && !(this->size > 0.)))
+        throw std::invalid_argument("Bad parameters of reporting: " + spec);
+}
+
+double Reporting::log_likelihood(int observed, int simulated) const
+{
+    // Return the log-probability of `observed` given `simulated` (-inf if impossible).
+    double y = observed, x = simulated;
+    if (this->kind == BINOMIAL)
+    {
+        if (y > x || y < 0.)
+            return -INFINITY;
+        double log_choose = std::lgamma(x + 1.) - std::lgamma(y + 1.) - std::lgamma(x - y + 1.);
+        return log_choose + ((y > 0.) ? y * std::log(this->p) : 0.)
+               + ((x > y) ? (x - y) * std::log1p(-this->p) : 0.);
+    }
+    double mean = this->p * x;
+    if (mean == 0.)
+        return (y == 0.) ? 0. : -INFINITY;
+    double r = this->size;
+    return std::lgamma(y + r) - std::lgamma(r) - std::lgamma(y + 1.) + r * std::log(r / (r + mean))
+           + y * std::log(mean / (r + mean));
+}
+
+ParticleFilter::ParticleFilter(const params_struct &params, const Eigen::VectorXi &observed, const Reporting &reporting,
+                               uint n_particles, uint seed, const CancelToken *token)
+    : log_likelihood(0.)
+{
+    uint n = n_particles;
+    uint n_observed = observed.size();
+    if (n == 0)
+        throw std::invalid_argument("At least one particle is needed");
+    if (n_observed == 0 || n_observed > lrint(1. * params.max_time / params.output_interval))
+        throw std::invalid_argument("Observed series empty or longer than the simulated one");
+    ThreadPool pool(std::max(params.n_threads, 1u));
+    params_struct particle_params = params;
+    particle_params.n_threads = 0; // particles run in parallel instead
+
+    std::vector<FilteredOutbreak *> particles(n);
+    for (uint i = 0; i < n; ++i)
+    {
+        std::seed_seq seq{seed, 0u, i};
+        std::mt19937_64 prng(seq);
+        particles[i] = new FilteredOutbreak(prng, particle_params, NULL, Silent(), false);
+    }
+
+    this->ess = Eigen::VectorXd::Zero(n_observed);
+    this->mean_reported = Eigen::VectorXd::Constant(n_observed, std::nan(""));
+    Eigen::VectorXd log_weights(n);
+    std::vector<uint> ancestors;
+    for (uint k = 0; k < n_observed; ++k)
+    {
+        if (token != NULL && token->expired())
+        {
+            this->log_likelihood = std::nan("");
+            break;
+        }
+        double until = (k + 1) * params.output_interval;
+        pool.parallel_for(n, [&](uint i) {
+            particles[i]->resume(until);
+            if (particles[i]->n_individuals > params.max_infected) // stopped (see ParticleFilter)
+                log_weights[i] = -INFINITY;
+            else
+                log_weights[i] = reporting.log_likelihood(observed[k], particles[i]->counters(k, 0));
+        });
+
+        double max = log_weights.maxCoeff();
+        if (!(max > -INFINITY))
+        {
+            this->log_likelihood = -INFINITY;
+            break;
+        }
+        Eigen::VectorXd weights = (log_weights.array() - max).exp();
+        double sum = weights.sum();
+        this->log_likelihood += max + std::log(sum / n);
+        weights /= sum;
+        this->ess[k] = 1. / weights.squaredNorm();
+        this->mean_reported[k] = 0.;
+        for (uint i = 0; i < n; ++i)
+            this->mean_reported[k] += weights[i] * particles[i]->counters(k, 0);
+        if (k + 1 == n_observed)
+            break;
+
+        std::seed_seq seq{seed, k + 1, n};
+        std::mt19937_64 prng(seq);
+        systematic_resample(weights, prng, ancestors);
+        std::vector<FilteredOutbreak *> resampled(n, NULL);
+        std::vector<bool> kept(n, false);
+        for (uint i = 0; i < n; ++i)
+            if (!kept[ancestors[i]])
+            {
+                kept[ancestors[i]] = true;
+                resampled[i] = particles[ancestors[i]];
+            }
+        // clones only read their source without the tree, so may be taken in parallel
+        pool.parallel_for(n, [&](uint i) {
+            if (resampled[i] != NULL)
+                return;
+            std::seed_seq seq{seed, k + 1, i};
+            std::mt19937_64 prng(seq);
+            resampled[i] = particles[ancestors[i]]->clone(prng);
+        });
+        for (uint i = 0; i < n; ++i)
+            if (!kept[i])
+                delete particles[i];
+        particles.swap(resampled);
+    }
+
+    for (std::vector<FilteredOutbreak *>::iterator it = particles.begin(); it != particles.end(); ++it)
+        delete *it;
+}
+
+ParticleMCMC::ParticleMCMC(const params_struct &params, const std::vector<Prior> &priors, const Eigen::VectorXd &initial,
+                           const Eigen::VectorXd &steps, const Eigen::VectorXi &observed, const pmcmc_struct &settings,
+                           uint seed, const CancelToken *token)
+    : n_accepted(0)
+{
+    uint n_params = priors.size();
+    if (initial.size() != n_params || steps.size() != n_params)
+        throw std::invalid_argument("An initial value and a step are needed for each parameter");
+    std::vector<std::string> names;
+    params_struct copy = params;
+    for (std::vector<Prior>::const_iterator it = priors.begin(); it != priors.end(); ++it)
+    {
+        if (it->name != "R0" && !set_param(copy, it->name, 0.))
+            throw std::invalid_argument("Unknown parameter: " + it->name);
+        names.push_back(it->name);
+    }
+    Reporting reporting(settings.reporting);
+    std::seed_seq seq{seed};
+    std::mt19937_64 prng(seq);
+
+    // log prior density of independent parameters, up to a constant, -inf out of the support
+    auto log_prior = [&priors, &names, n_params](const Eigen::VectorXd &x) -> double {
+        if (!in_support(names, x.data()))
+            return -INFINITY;
+        double sum = 0.;
+        for (uint j = 0; j < n_params; ++j)
+            sum += std::log(priors[j].density(x[j]));
+        return sum;
+    };
+
+    Eigen::VectorXd x = initial;
+    double x_log_prior = log_prior(x);
+    if (!(x_log_prior > -INFINITY))
+        throw std::invalid_argument("Initial values outside the priors");
+    double x_log_likelihood = ParticleFilter(with_values(params, names, x.data()), observed, reporting,
+                                             settings.n_particles, random_bits(prng), token).log_likelihood;
+
+    this->chain.resize(settings.n_iterations, n_params);
+    this->log_likelihoods.resize(settings.n_iterations);
+    Eigen::VectorXd y(n_params);
+    for (uint t = 0; t < settings.n_iterations; ++t)
+    {
+        if (token != NULL && token->expired())
+        {
+            this->chain.conservativeResize(t, n_params);
+            this->log_likelihoods.conservativeResize(t);
+            break;
+        }
+        for (uint j = 0; j < n_params; ++j)
+            y[j] = x[j] + steps[j] * normal01(prng);
+        double y_log_prior = log_prior(y);
+        if (y_log_prior > -INFINITY)
+        {
+            double y_log_likelihood = ParticleFilter(with_values(params, names, y.data()), observed, reporting,
+                                                     settings.n_particles, random_bits(prng), token).log_likelihood;
+            double log_ratio = (y_log_likelihood + y_log_prior) - (x_log_likelihood + x_log_prior);
+            if (!(x_log_likelihood > -INFINITY) && !(y_log_likelihood > -INFINITY))
+                log_ratio = y_log_prior - x_log_prior; // neither fits (see ParticleMCMC)
+            if (std::log(uniform01(prng)) < log_ratio)
+            {
+                x = y;
+                x_log_prior = y_log_prior;
+                x_log_likelihood = y_log_likelihood;
+                this->n_accepted++;
+            }
+        }
+        this->chain.row(t) = x.transpose();
+        this->log_likelihoods[t] = x_log_likelihood;
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef INFERENCE_H
+#define INFERENCE_H
+
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "cancel.hpp"
+#include "infectee.hpp"
+#include "summaries.hpp"
+#include "distance.hpp"
+
+// Prior distribution of a parameter, from a spec such as "uniform:1.05:4":
+//   uniform:a:b, normal:mean:sd, truncnorm:mean:sd:a:b, lognormal:meanlog:sdlog
+class Prior
+{
+    public:
+        Prior(const std::string &name, const std::string &spec); // Throws std::invalid_argument for bad specs.
+
+        double operator()(std::mt19937_64 &prng) const; // Draw a value.
+        double density(double x) const;    // Return the density at x, up to a constant factor.
+        static bool is_spec(const std::string &spec);   // Return whether `spec` looks like a prior.
+
+        std::string name;                  // field of params_struct (see set_param) or R0
+
+    private:
+        enum Kind { UNIFORM, NORMAL, TRUNCNORM, LOGNORMAL };
+        Kind kind;
+        double args[4];
+};
+
+// Simulated reported counts given parameter values, compared to observed ones directly
+// (stopping simulations once their partial distance exceeds a threshold) or through
+// summary statistics (see summaries.hpp). As in simulateR0, only "exploding" simulations
+// are considered, up to MAX_REDRAWS redraws.
+//
+// The inference below stops early once its `token` (if not NULL) expires, e.g. on Ctrl-C,
+// leaving the results so far.
+class AbcModel
+{
+    public:
+        AbcModel(const params_struct &params, const std::vector<std::string> &names, const Eigen::VectorXi &observed,
+                 const std::string &summaries = "", const Eigen::VectorXd &weights = Eigen::VectorXd(),
+                 const Eigen::VectorXd &scales = Eigen::VectorXd());
+
+        // Simulate and return the distance, infinity if cancelled by `token` (if not NULL).
+        double distance(const double *values, std::mt19937_64 &prng, double threshold,
+                        const CancelToken *token = NULL) const;
+
+        params_struct params;              // fixed parameters
+        std::vector<std::string> names;    // parameters given values: fields of params or R0
+        uint n_threads;                    // simulations run in parallel (params.n_threads)
+
+    private:
+        uint n_output;                     // simulated output steps
+        uint n_observed;                   // observed output steps
+        bool use_summaries;                // compare summaries rather than counts
+        Summaries kernels;                 // over the observed output steps
+        Distance to_observed;              // to the observed counts or their summaries
+};
+
+const uint MAX_REDRAWS = 100; // simulations drawn at most for getting an "exploding" one
+
+// Rejection ABC: simulations with parameters drawn from their priors, keeping the n_keep
+// nearest to the observed ones within threshold (all within threshold if n_keep is 0).
+// Simulations run on params.n_threads threads, each with its own random stream, so that
+// the results do not depend on the number of threads. While the kept ones are full, the
+// farthest of them bounds the distance of further simulations, stopping them early.
+class RejectionABC
+{
+    public:
+        RejectionABC(const AbcModel &model, const std::vector<Prior> &priors, uint n_samples, uint n_keep,
+                     double threshold, uint seed, const CancelToken *token = NULL);
+
+        Eigen::MatrixXd samples;           // kept parameter values (rows) in order of distance
+        Eigen::VectorXd distances;         // their distances
+};
+
+// settings of AbcSMC
+struct smc_struct
+{
+    uint n_particles = 1000;
+    uint n_rounds = 10;                // incl. the first one from the priors
+    double quantile = 0.5;             // of the distances giving the threshold of the next round
+    double min_threshold = 0.;         // threshold ending the rounds once reached
+    double ess_fraction = 0.5;         // resampling when the effective sample size drops below this * n_particles
+    uint max_attempts = 10000;         // proposals per particle ending the rounds when exceeded
+};
+
+// ABC sequential Monte Carlo (population Monte Carlo, Beaumont et al. 2009): particles from
+// the priors, then each round new particles within the previous distances' quantile, drawn
+// from the weighted previous ones perturbed by a Gaussian kernel with twice their weighted
+// covariance, weighted by prior / kernel mixture density, and resampled (systematically)
+// when their effective sample size gets low. As RejectionABC, the particles of a round are
+// simulated in parallel, each with its own random stream, bounding the distances by the
+// threshold of the round. Rounds end early when a particle exceeds max_attempts, keeping
+// the particles of the previous round.
+class AbcSMC
+{
+    public:
+        AbcSMC(const AbcModel &model, const std::vector<Prior> &priors, const smc_struct &settings, uint seed,
+               const CancelToken *token = NULL);
+
+        Eigen::MatrixXd particles;         // parameter values (rows) of the last round
+        Eigen::VectorXd weights;           // their normalized importance weights
+        Eigen::VectorXd distances;         // their distances
+        std::vector<double> thresholds;    // per round, infinity for the first one
+        std::vector<double> ess;           // effective sample size per round, before resampling
+        uint64_t n_simulations;            // proposals simulated over all rounds
+
+    private:
+        double prior_density(const double *x, const std::vector<Prior> &priors) const; // Return the joint density.
+        void resample(std::mt19937_64 &prng); // Resample systematically to equal weights.
+};
+
+// Observation model of observed reported counts given simulated ones, from a spec such as
+// "binomial:0.8" (no default, as binomial:1 gives -inf to any count missed by the simulation):
+//   binomial:p (each simulated count reported with probability p),
+//   negbinomial:p:size (mean p times the simulated count, variance mean + mean^2 / size)
+class Reporting
+{
+    public:
+        Reporting(const std::string &spec); // Throws std::invalid_argument for bad specs.
+
+        double log_likelihood(int observed, int simulated) const; // Return the log-probability of `observed`.
+
+    private:
+        enum Kind { BINOMIAL, NEGBINOMIAL };
+        Kind kind;
+        double p;
+        double size;
+};
+
+// Bootstrap particle filter (Gordon et al. 1993) of observed reported counts: outbreaks with
+// params (ReportedCounts without the tree) are advanced by an output interval at a time,
+// weighted by the observation model and resampled systematically at each observed step.
+// The first copy of a resampled particle continues it, the others are clones with their
+// own random streams. Particles run on params.n_threads threads, each with its own random
+// stream, so that the results do not depend on the number of threads. Unlike simulateR0,
+// outbreaks dying out are kept. Particles reaching params.max_infected are given weight
+// zero, as their counts after stopping would be wrong.
+class ParticleFilter
+{
+    public:
+        ParticleFilter(const params_struct &params, const Eigen::VectorXi &observed, const Reporting &reporting,
+                       uint n_particles, uint seed, const CancelToken *token = NULL);
+
+        double log_likelihood;             // estimate of the log marginal likelihood, -inf if no particle fits,
+                                           // NaN if cancelled
+        Eigen::VectorXd ess;               // effective sample size per observed step, before resampling
+        Eigen::VectorXd mean_reported;     // weighted mean of the simulated counts per observed step
+};
+
+// settings of ParticleMCMC
+struct pmcmc_struct
+{
+    uint n_particles = 500;            // of each ParticleFilter
+    uint n_iterations = 1000;
+    std::string reporting;             // spec of Reporting, needed
+};
+
+// Particle marginal Metropolis-Hastings (Andrieu et al. 2010): a Gaussian random walk over
+// the parameters of the priors (R0 or fields of params_struct), accepted by their prior
+// density times the likelihood estimated by a ParticleFilter with its own seed. Where neither
+// the current nor the proposed values fit the observed counts, the walk follows the priors.
+class ParticleMCMC
+{
+    public:
+        ParticleMCMC(const params_struct &params, const std::vector<Prior> &priors, const Eigen::VectorXd &initial,
+                     const Eigen::VectorXd &steps, const Eigen::VectorXi &observed, const pmcmc_struct &settings,
+                     uint seed, const CancelToken *token = NULL);
+
+        Eigen::MatrixXd chain;             // parameter values (rows) per iteration, up to cancelling
+        Eigen::VectorXd log_likelihoods;   // their estimated log-likelihoods
+        uint n_accepted;                   // accepted proposals
+};
+
+#endif
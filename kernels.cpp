@@ -0,0 +1,127 @@
+// Contains the kernels with runtime dispatch to the instruction set of the CPU.
+
+#include "kernels.hpp"
+
+// GCC emits a clone of each kernel per target and an ifunc resolver choosing among
+// them at load time. Elsewhere the kernels are compiled once for the build target.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && !defined(NO_CPU_DISPATCH)
+#define KERNEL __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define KERNEL
+#endif
+
+const char *kernel_isa()
+{
+    // Return the instruction set picked for the kernels (same order as in KERNEL).
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && !defined(NO_CPU_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return "avx512f";
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+    if (__builtin_cpu_supports("sse4.2"))
+        return "sse4.2";
+#endif
+    return "default";
+}
+
+KERNEL void kernel_bits_to_uniform(const uint64_t *bits, double *out, size_t n)
+{
+    // Convert random bits to uniforms in [0, 1) from the top 53 bits.
+    for (size_t i = 0; i < n; ++i)
+        out[i] = static_cast<double>(bits[i] >> 11) * (1. / 9007199254740992.);
+}
+
+KERNEL void kernel_mark_due(const double *next_end, size_t n, double time, uint8_t *due)
+{
+    // Mark the phases ending by time.
+    for (size_t i = 0; i < n; ++i)
+        due[i] = time >= next_end[i];
+}
+
+KERNEL void kernel_mark_infectious(const uint8_t *states, size_t n, uint8_t *infectious)
+{
+    // Mark the infectious states (2 and 3).
+    for (size_t i = 0; i < n; ++i)
+        infectious[i] = (states[i] == 2) | (states[i] == 3);
+}
+
+KERNEL void kernel_count_states(const uint8_t *states, size_t n, uint n_states, uint32_t *counts)
+{
+    // Count each state below n_states, by a pass per state to allow vectorization.
+    for (uint s = 0; s < n_states; ++s)
+    {
+        uint32_t count = 0;
+        for (size_t i = 0; i < n; ++i)
+            count += states[i] == s;
+        counts[s] = count;
+    }
+}
+
+KERNEL void kernel_mark_below(const double *u, const uint32_t *group, const double *p, size_t n, uint8_t *hit)
+{
+    // Mark u[i] < p[group[i]], i.e. Bernoulli draws with per-group probabilities.
+    for (size_t i = 0; i < n; ++i)
+        hit[i] = u[i] < p[group[i]];
+}
+
+KERNEL double kernel_sum(const double *x, size_t n)
+{
+    // Return the sum of x (in four partial sums to allow vectorization).
+    double partial[4] = {0., 0., 0., 0.};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (size_t j = 0; j < 4; ++j)
+            partial[j] += x[i + j];
+    for (; i < n; ++i)
+        partial[0] += x[i];
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+KERNEL double kernel_dot(const double *x, const double *y, size_t n)
+{
+    // Return the dot product of x and y (in four partial sums to allow vectorization).
+    double partial[4] = {0., 0., 0., 0.};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (size_t j = 0; j < 4; ++j)
+            partial[j] += x[i + j] * y[i + j];
+    for (; i < n; ++i)
+        partial[0] += x[i] * y[i];
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+KERNEL void kernel_mean_var(const double *x, size_t n, double *mean, double *var)
+{
+    // Compute the mean and (biased) variance of x in two passes.
+    *mean = *var = 0.;
+    if (n == 0)
+        return;
+    double partial[4] = {0., 0., 0., 0.};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (size_t j = 0; j < 4; ++j)
+            partial[j] += x[i + j];
+    for (; i < n; ++i)
+        partial[0] += x[i];
+    *mean = ((partial[0] + partial[1]) + (partial[2] + partial[3])) / n;
+
+    for (size_t j = 0; j < 4; ++j)
+        partial[j] = 0.;
+    for (i = 0; i + 4 <= n; i += 4)
+        for (size_t j = 0; j < 4; ++j)
+            partial[j] += (x[i + j] - *mean) * (x[i + j] - *mean);
+    for (; i < n; ++i)
+        partial[0] += (x[i] - *mean) * (x[i] - *mean);
+    *var = ((partial[0] + partial[1]) + (partial[2] + partial[3])) / n;
+}
+
+KERNEL void kernel_differences(const double *x, size_t n, double *out)
+{
+    // Set out to the differences of consecutive x, from x[0], i.e. invert a prefix sum.
+    if (n == 0)
+        return;
+    out[0] = x[0];
+    for (size_t i = 1; i < n; ++i)
+        out[i] = x[i] - x[i - 1];
+}
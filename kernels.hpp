@@ -0,0 +1,26 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// Loops over arrays meant for vectorization. Each is compiled for several instruction
+// sets (see KERNEL in kernels.cpp), the best of which is picked when the library is
+// loaded, so that a single build runs optimally on each node. Their names are prefixed
+// by kernel_ to keep them apart from the members and functions they serve.
+
+const char *kernel_isa(); // Return the instruction set picked for the kernels.
+
+void kernel_bits_to_uniform(const uint64_t *bits, double *out, size_t n); // Convert random bits to uniforms in [0, 1).
+void kernel_mark_due(const double *next_end, size_t n, double time, uint8_t *due); // Mark phases ending by time.
+void kernel_mark_infectious(const uint8_t *states, size_t n, uint8_t *infectious); // Mark states 2 and 3.
+void kernel_count_states(const uint8_t *states, size_t n, uint n_states, uint32_t *counts); // Count each state below n_states.
+void kernel_mark_below(const double *u, const uint32_t *group, const double *p, size_t n, uint8_t *hit); // Mark u[i] < p[group[i]].
+double kernel_sum(const double *x, size_t n);                              // Return the sum of x.
+double kernel_dot(const double *x, const double *y, size_t n);             // Return the dot product of x and y.
+void kernel_mean_var(const double *x, size_t n, double *mean, double *var); // Compute the mean and (biased) variance of x.
+void kernel_differences(const double *x, size_t n, double *out);           // Set out to x[0], x[1] - x[0], ...
+
+#endif
@@ -0,0 +1,265 @@
+// Contains the implementation for writing binary line lists.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "linelist.hpp"
+
+static_assert(sizeof(LineListHeader) == 64, "unexpected padding in LineListHeader");
+static_assert(sizeof(LineListRecord) == 56, "unexpected padding in LineListRecord");
+
+const size_t LINE_LIST_BUFFER = 8192; // records per write to disk
+
+LineListWriter::LineListWriter(const std::string &path) : path(path), n_records(0), failed(false)
+{
+    const uint16_t probe = 1;
+    if (*reinterpret_cast<const uint8_t *>(&probe) != 1)
+        throw std::runtime_error("Line lists are written on little-endian hosts only");
+
+    this->file = std::fopen(path.c_str(), "wb");
+    if (this->file == NULL)
+        throw std::runtime_error("Cannot open " + path);
+    this->buffer.reserve(LINE_LIST_BUFFER);
+
+    LineListHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LINE_LIST_MAGIC, sizeof(header.magic));
+    header.version = LINE_LIST_VERSION;
+    header.header_size = sizeof(LineListHeader);
+    header.record_size = sizeof(LineListRecord);
+    // on disk at once, so that the file can be read before the first records are
+    this->failed = std::fwrite(&header, sizeof(header), 1, this->file) != 1 || std::fflush(this->file) != 0;
+}
+
+LineListWriter::~LineListWriter()
+{
+    if (this->file != NULL)
+    {
+        this->flush();
+        std::fclose(this->file);
+    }
+}
+
+void LineListWriter::write(const Infectee &infectee)
+{
+    // Append the record of `infectee`.
+    LineListRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.id = infectee.id;
+    record.infector = infectee.infector_id;
+    record.infection_time = infectee.infection_time;
+    record.symptom = infectee.status_trajectory[1];
+    record.outcome = infectee.status_trajectory[3];
+    record.end_times[0] = infectee.end_times[0];
+    record.end_times[1] = infectee.end_times[record.symptom];
+    record.end_times[2] = infectee.end_times[3];
+    record.end_times[3] = infectee.end_times[record.outcome];
+    this->buffer.push_back(record);
+    this->infectors.push_back(record.infector);
+
+    if (this->buffer.size() >= LINE_LIST_BUFFER)
+        this->flush();
+}
+
+void LineListWriter::flush()
+{
+    // Write the buffer to disk and the number of records to the header, so that the file
+    // can be read during the run.
+    if (this->buffer.empty() || this->failed)
+        return;
+    size_t n = std::fwrite(this->buffer.data(), sizeof(LineListRecord), this->buffer.size(), this->file);
+    this->n_records += n;
+    this->failed = n != this->buffer.size();
+    this->buffer.clear();
+
+    long end = std::ftell(this->file);
+    this->failed = this->failed || std::fseek(this->file, offsetof(LineListHeader, n_records), SEEK_SET) != 0
+                   || std::fwrite(&this->n_records, sizeof(this->n_records), 1, this->file) != 1
+                   || std::fseek(this->file, end, SEEK_SET) != 0;
+}
+
+void LineListWriter::close()
+{
+    // Write the remaining records and close the file.
+    if (this->file == NULL)
+        return;
+    this->flush();
+    this->write_index();
+    bool failed = (std::fclose(this->file) != 0) || this->failed;
+    this->file = NULL;
+    if (failed)
+        throw std::runtime_error("Cannot write " + this->path);
+}
+
+void LineListWriter::write_index()
+{
+    // Append the child index: offsets by counting the infected of each id, then the
+    // infected in order of id (counting sort by infector).
+    if (this->failed)
+        return;
+    uint64_t n = this->infectors.size();
+    std::vector<uint64_t> offsets(n + 1, 0);
+    for (std::vector<uint32_t>::iterator it = this->infectors.begin(); it != this->infectors.end(); ++it)
+        if (*it != NO_INFECTOR)
+            offsets[*it + 1]++;
+    for (uint64_t i = 0; i < n; ++i)
+        offsets[i + 1] += offsets[i];
+
+    std::vector<uint32_t> children(offsets[n]);
+    std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    for (uint64_t id = 0; id < n; ++id)
+        if (this->infectors[id] != NO_INFECTOR)
+            children[next[this->infectors[id]]++] = id;
+
+    uint64_t csr_offset = sizeof(LineListHeader) + n * sizeof(LineListRecord);
+    this->failed = std::fwrite(offsets.data(), sizeof(uint64_t), n + 1, this->file) != n + 1
+                   || std::fwrite(children.data(), sizeof(uint32_t), children.size(), this->file) != children.size()
+                   || std::fseek(this->file, offsetof(LineListHeader, csr_offset), SEEK_SET) != 0
+                   || std::fwrite(&csr_offset, sizeof(csr_offset), 1, this->file) != 1;
+}
+
+uint64_t LineListWriter::size() const
+{
+    // Return the number of records written so far.
+    return this->n_records + this->buffer.size();
+}
+
+LineListReader::LineListReader(const std::string &path) : data(MAP_FAILED), length(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        throw std::runtime_error("Cannot open " + path);
+    }
+    this->length = st.st_size;
+    if (this->length >= sizeof(LineListHeader))
+        this->data = ::mmap(NULL, this->length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    const LineListHeader *header = static_cast<const LineListHeader *>(this->data);
+    if (this->data == MAP_FAILED || std::memcmp(header->magic, LINE_LIST_MAGIC, sizeof(header->magic)) != 0
+        || header->version != LINE_LIST_VERSION || header->record_size != sizeof(LineListRecord)
+        || header->header_size < sizeof(LineListHeader) || header->header_size > this->length
+        || header->header_size % alignof(LineListRecord) != 0)
+    {
+        if (this->data != MAP_FAILED)
+            ::munmap(this->data, this->length);
+        throw std::runtime_error("Not a line list: " + path);
+    }
+
+    // the header may lag behind the records of a file being written
+    const char *bytes = static_cast<const char *>(this->data);
+    this->records = reinterpret_cast<const LineListRecord *>(bytes + header->header_size);
+    this->n_records = std::min<uint64_t>(header->n_records,
+                                         (this->length - header->header_size) / sizeof(LineListRecord));
+    if (header->csr_offset > 0 && this->n_records == header->n_records && this->valid_index(header->csr_offset))
+    {
+        this->offsets = reinterpret_cast<const uint64_t *>(bytes + header->csr_offset);
+        this->children = reinterpret_cast<const uint32_t *>(this->offsets + this->n_records + 1);
+    }
+    else
+        this->build_index();
+}
+
+bool LineListReader::valid_index(uint64_t csr_offset) const
+{
+    // Return whether the child index at `csr_offset` lies after the records and within the
+    // file, with offsets increasing from 0 and children that are ids of records.
+    uint64_t n = this->n_records;
+    uint64_t records_end = reinterpret_cast<const char *>(this->end()) - static_cast<const char *>(this->data);
+    if (csr_offset < records_end || csr_offset % sizeof(uint64_t) != 0 || csr_offset > this->length
+        || (this->length - csr_offset) / sizeof(uint64_t) < n + 1)
+        return false;
+    const uint64_t *offsets = reinterpret_cast<const uint64_t *>(static_cast<const char *>(this->data) + csr_offset);
+    uint64_t children_start = csr_offset + (n + 1) * sizeof(uint64_t);
+    if (offsets[0] != 0 || offsets[n] > (this->length - children_start) / sizeof(uint32_t))
+        return false;
+    for (uint64_t i = 0; i < n; ++i)
+        if (offsets[i] > offsets[i + 1])
+            return false;
+    const uint32_t *children = reinterpret_cast<const uint32_t *>(offsets + n + 1);
+    for (uint64_t j = 0; j < offsets[n]; ++j)
+        if (children[j] >= n)
+            return false;
+    return true;
+}
+
+LineListReader::~LineListReader()
+{
+    ::munmap(this->data, this->length);
+}
+
+uint64_t LineListReader::size() const
+{
+    // Return the number of records.
+    return this->n_records;
+}
+
+const LineListRecord *LineListReader::begin() const
+{
+    return this->records;
+}
+
+const LineListRecord *LineListReader::end() const
+{
+    return this->records + this->n_records;
+}
+
+const LineListRecord &LineListReader::operator[](uint64_t id) const
+{
+    return this->records[id];
+}
+
+static bool infected_before(const LineListRecord &record, double time)
+{
+    return record.infection_time < time;
+}
+
+uint64_t LineListReader::lower_bound(double time) const
+{
+    // Return the first id infected at `time` or later (binary search, as records are in
+    // order of infection time).
+    return std::lower_bound(this->begin(), this->end(), time, infected_before) - this->begin();
+}
+
+const uint32_t *LineListReader::children_begin(uint64_t id) const
+{
+    // Return the beginning of the range of the ids infected by `id`.
+    return this->children + this->offsets[id];
+}
+
+const uint32_t *LineListReader::children_end(uint64_t id) const
+{
+    // Return the end of the range of the ids infected by `id`.
+    return this->children + this->offsets[id + 1];
+}
+
+void LineListReader::build_index()
+{
+    // Build the child index in memory, as LineListWriter::write_index.
+    uint64_t n = this->n_records;
+    this->own_offsets.assign(n + 1, 0);
+    for (uint64_t id = 0; id < n; ++id)
+        if (this->records[id].infector < n)
+            this->own_offsets[this->records[id].infector + 1]++;
+    for (uint64_t i = 0; i < n; ++i)
+        this->own_offsets[i + 1] += this->own_offsets[i];
+
+    this->own_children.resize(this->own_offsets[n]);
+    std::vector<uint64_t> next(this->own_offsets.begin(), this->own_offsets.end() - 1);
+    for (uint64_t id = 0; id < n; ++id)
+        if (this->records[id].infector < n)
+            this->own_children[next[this->records[id].infector]++] = id;
+
+    this->offsets = this->own_offsets.data();
+    this->children = this->own_children.data();
+}
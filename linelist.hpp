@@ -0,0 +1,110 @@
+#ifndef LINELIST_H
+#define LINELIST_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "infectee.hpp"
+
+// Binary line list of an outbreak: a header followed by one fixed-width record per infected
+// individual in order of infection (i.e. by id), all little-endian. The records are written
+// as individuals are infected, as their whole course is drawn then. Each column is a field
+// of a numpy structured array, mapped without parsing:
+//
+//   dtype = np.dtype([('id', '<u4'), ('infector', '<u4'), ('infection_time', '<f8'),
+//                     ('end_times', '<f8', 4), ('symptom', 'u1'), ('outcome', 'u1'), ('', 'V6')])
+//   n = int(np.fromfile(path, '<u8', 1, offset=24)[0])
+//   lines = np.memmap(path, dtype, 'r', offset=64, shape=n)
+//
+// On closing, the writer appends a child index in compressed sparse row form: n + 1
+// uint64 offsets followed by the uint32 ids of the infected of each id in turn, so that
+// the infected of id i are children[offsets[i]:offsets[i + 1]]. Records are in order of
+// infection time too, as individuals are numbered at the end of each time step.
+
+const char LINE_LIST_MAGIC[8] = {'O', 'B', 'L', 'I', 'N', 'E', 'S', '\0'};
+const uint32_t LINE_LIST_VERSION = 1;
+
+struct LineListHeader
+{
+    char magic[8];                     // LINE_LIST_MAGIC
+    uint32_t version;                  // LINE_LIST_VERSION
+    uint32_t header_size;              // offset of the first record
+    uint32_t record_size;              // bytes per record
+    uint32_t reserved0;
+    uint64_t n_records;                // number of records, updated with each write to disk
+    uint64_t csr_offset;               // offset of the child index, 0 until closed
+    uint64_t reserved[3];
+};
+
+struct LineListRecord
+{
+    uint32_t id;                       // number in order of infection, i.e. the record index
+    uint32_t infector;                 // id of the infector or NO_INFECTOR
+    double infection_time;
+    double end_times[4];               // ends of the phases: latent, symptom, symptoms (3), outcome
+    uint8_t symptom;                   // 1 (symptoms before infectious) or 2 (infectious before symptoms)
+    uint8_t outcome;                   // 4 (recovering) or 5 (dying)
+    uint8_t padding[6];
+};
+
+// Streams the line list of an outbreak to a file through a buffer (see Outbreak).
+class LineListWriter
+{
+    public:
+        LineListWriter(const std::string &path);
+        ~LineListWriter();
+
+        void write(const Infectee &infectee); // Append the record of `infectee`.
+        void close();                      // Write the remaining records and close the file.
+        uint64_t size() const;             // Return the number of records written so far.
+
+    private:
+        std::string path;
+        std::FILE *file;
+        std::vector<LineListRecord> buffer;
+        uint64_t n_records;                // records on disk
+        std::vector<uint32_t> infectors;   // infector of each record, for the child index
+        bool failed;                       // whether writing to disk failed
+
+        void flush();                      // Write the buffer to disk.
+        void write_index();                // Append the child index.
+};
+
+// Read-only view of a line list mapped into memory. Records are accessed in place, so
+// that files larger than memory can be sliced. Without a valid child index (e.g. a file
+// still being written, or a truncated one), one is built in memory. Throws
+// std::runtime_error for files that are not line lists.
+class LineListReader
+{
+    public:
+        LineListReader(const std::string &path);
+        LineListReader(const LineListReader &) = delete;
+        LineListReader &operator=(const LineListReader &) = delete;
+        ~LineListReader();
+
+        uint64_t size() const;             // Return the number of records.
+        const LineListRecord *begin() const;
+        const LineListRecord *end() const;
+        const LineListRecord &operator[](uint64_t id) const;
+
+        uint64_t lower_bound(double time) const; // Return the first id infected at `time` or later.
+        const uint32_t *children_begin(uint64_t id) const; // Return the range of the ids infected by `id`.
+        const uint32_t *children_end(uint64_t id) const;
+
+    private:
+        void *data;                        // mapped file
+        size_t length;
+        uint64_t n_records;
+        const LineListRecord *records;
+        const uint64_t *offsets;           // child index
+        const uint32_t *children;
+        std::vector<uint64_t> own_offsets; // child index built in memory, if not in the file
+        std::vector<uint32_t> own_children;
+
+        bool valid_index(uint64_t csr_offset) const; // Return whether the child index in the file is usable.
+        void build_index();                // Build the child index in memory.
+};
+
+#endif
@@ -0,0 +1,822 @@
+#ifndef OUTBREAK_H
+#define OUTBREAK_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <math.h>
+#include <random>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <Eigen/Core>
+
+#include "infectee.hpp"
+#include "compartments.hpp"
+#include "linelist.hpp"
+#include "estimates.hpp"
+#include "threadpool.hpp"
+#include "checkpoint.hpp"
+#include "cancel.hpp"
+#include "kernels.hpp"
+
+// Policies for specializing Outbreak at compile time, so that the innermost loop
+// over individuals carries no tests for them.
+
+// Tracking: whether to keep who infected whom.
+struct TrackTree
+{
+    static const bool track_tree = true;
+};
+
+struct TrackCounts
+{
+    static const bool track_tree = false;
+};
+
+// Instrumentation: called at output steps and on events outside the innermost loop.
+// A run ends early once stop() returns true after an output step.
+struct Silent
+{
+    static const bool verbose = false;
+    void output(double, const Eigen::MatrixXi &, uint) {}
+    void message(const std::string &) {}
+    bool stop() const { return false; }
+};
+
+struct Verbose
+{
+    static const bool verbose = true;
+    void output(double time, const Eigen::MatrixXi &counters, uint row)
+    {
+        std::cout << "t=" << time << ": " << counters.row(row) << std::endl;
+    }
+    void message(const std::string &msg)
+    {
+        std::cout << msg << std::endl;
+    }
+    bool stop() const { return false; }
+};
+
+// Monitor stopping also once `token` expires (see CancelToken), e.g. Cancellable<Silent>.
+template <class Monitor>
+struct Cancellable : public Monitor
+{
+    Cancellable(const CancelToken &token, const Monitor &monitor = Monitor()) : Monitor(monitor), token(&token) {}
+    bool stop() const { return this->Monitor::stop() || this->cancelled(); }
+    bool cancelled() const { return this->token->expired(); }
+
+    const CancelToken *token;
+};
+
+// Return `count` rounded and saturated to INT_MAX (large outbreaks with Compartments).
+inline int saturate_count(double count)
+{
+    return static_cast<int>(std::min(std::floor(count + 0.5), 1. * INT_MAX));
+}
+
+// Output granularity: the columns of counters.
+struct StateCounts // individuals in each infection state
+{
+    static const uint n_columns = N_STATES;
+    static void add(Eigen::MatrixXi &counters, uint row, const Eigen::ArrayXd &state_counts)
+    {
+        for (uint s = 0; s < N_STATES; ++s)
+            counters(row, s) = saturate_count(counters(row, s) + state_counts[s]);
+    }
+};
+
+struct ReportedCounts // reported individuals only (i.e. symptoms shown)
+{
+    static const uint n_columns = 1;
+    static void add(Eigen::MatrixXi &counters, uint row, const Eigen::ArrayXd &state_counts)
+    {
+        counters(row, 0) = saturate_count(counters(row, 0) + state_counts.sum()
+                                          - state_counts[0] - state_counts[2]);
+    }
+};
+
+// Individuals per chunk when stepping in parallel (see params.n_threads). Fixed, so that the
+// chunks and their random streams do not depend on the number of threads.
+const size_t STEP_CHUNK_SIZE = 4096;
+
+// Results of stepping a chunk of the active individuals, merged in chunk order.
+struct StepChunk
+{
+    size_t kept;                                      // end of the individuals kept in `active`
+    std::vector<Infectee *> new_infected, infectious; // as in Outbreak
+    std::vector<Infectee *> over;                     // to be deleted once done infecting (tau-leaping, no tree)
+    Eigen::ArrayXd retired;                           // individuals removed from `active` per state
+    Eigen::MatrixXi counters;                         // counts at an output step (one row)
+    std::vector<uint8_t> states;                      // states of the kept individuals at an output step
+};
+
+// Individuals shared by an outbreak and its copies (see Outbreak::share), deleted with the
+// last of them.
+struct SharedInfectees
+{
+    SharedInfectees() {}
+    SharedInfectees(const SharedInfectees &) = delete;
+    SharedInfectees &operator=(const SharedInfectees &) = delete;
+    ~SharedInfectees()
+    {
+        for (std::vector<Infectee *>::iterator it = this->individuals.begin(); it != this->individuals.end(); ++it)
+            delete *it;
+    }
+
+    std::vector<Infectee *> individuals;
+};
+
+template <class Rng = std::mt19937_64, class Tracking = TrackTree, class Monitor = Silent,
+          class Output = StateCounts>
+class Outbreak
+{
+  public:
+    std::vector<Infectee *> infected; // infected individuals (present and past), if tracked
+    std::vector<Infectee *> active;   // infected individuals not yet recovered nor dead
+    uint n_infected;                  // number of individuals infected so far, also in `compartments`
+    uint n_individuals;               // number of individuals drawn so far
+    Eigen::MatrixXi counters;         // counts per output interval (columns by Output)
+    Rng prng;                         // pseudo random-number generator
+    Monitor monitor;                  // instrumentation
+    params_struct params;             // user-given parameters (defaults in infectee.hpp)
+    Samplers samplers;                // random distributions set up from params
+    Eigen::ArrayXd retired;           // counts of individuals removed from `active` per state
+    Compartments compartments;        // approximation for large outbreaks (see params.hybrid_threshold)
+    bool is_compartmental;            // whether `compartments` is currently in use
+    bool compartmental_interval;      // whether `compartments` was used in the current output interval
+    std::vector<Infectee *> new_infected, infectious; // scratch space for a time step
+    ThreadPool pool;                  // threads for stepping individuals (see params.n_threads)
+    std::vector<StepChunk> chunks;    // scratch space per chunk of individuals
+    LineListWriter *line_list;        // receives each infected individual, if not NULL
+    R0Estimate r0_estimate;           // estimate of R0 maintained as individuals are infected
+    Eigen::VectorXd R0_series;        // estimate of R0 at each output step
+    CaseEstimates case_estimates;     // case reproduction numbers and interval histograms
+
+    std::vector<std::shared_ptr<const SharedInfectees> > shared; // individuals shared with copies
+    double time;                      // time of the next time step
+    uint output_counter;              // next row of counters
+    bool finished;                    // whether the run is over (max_time, max_infected or the monitor)
+    CheckpointWriter *checkpoints;    // receives the state at its interval, if not NULL
+
+    // Simulate an outbreak drawing from `prng`. With `run` false, only the first individual is
+    // drawn, from the own copy of `prng`, and the run is continued by resume().
+    Outbreak(Rng &prng, const params_struct &params = params_struct(), LineListWriter *line_list = NULL,
+             const Monitor &monitor = Monitor(), bool run = true)
+        : prng(prng), monitor(monitor), params(params), samplers(params), compartments(params), pool(params.n_threads),
+          line_list(line_list), r0_estimate(params), case_estimates(params), checkpoints(NULL)
+    {
+        this->params.track_tree = Tracking::track_tree;
+        this->params.verbose = Monitor::verbose;
+        uint n_output = lrint(1. * params.max_time / params.output_interval);
+        this->counters = Eigen::MatrixXi::Zero(n_output, Output::n_columns);
+        this->R0_series = Eigen::VectorXd::Constant(n_output, std::nan(""));
+        this->retired = Eigen::ArrayXd::Zero(N_STATES);
+        this->is_compartmental = false;
+        this->compartmental_interval = false;
+
+        this->n_infected = 0;
+        this->n_individuals = 0;
+        this->active.push_back(new Infectee(NULL, 0, run ? prng : this->prng, this->samplers));
+        this->born(this->active.back());
+        if (Tracking::track_tree)
+            this->infected.push_back(this->active.back());
+        this->output_counter = 0;
+        this->time = params.timestep;
+        this->finished = false;
+
+        if (run)
+            this->run(INFINITY, prng);
+    }
+
+    // Copy the outbreak `source` to continue from its current state with the random stream
+    // `prng`. Individuals that do not change anymore are shared rather than copied (see share),
+    // the others are copied. The copy writes no line list.
+    Outbreak(Outbreak &source, const Rng &prng)
+        : n_infected(source.n_infected), n_individuals(source.n_individuals), counters(source.counters), prng(prng),
+          monitor(source.monitor), params(source.params), samplers(source.samplers), retired(source.retired),
+          compartments(source.compartments), is_compartmental(source.is_compartmental),
+          compartmental_interval(source.compartmental_interval), pool(source.params.n_threads),
+          line_list(NULL), r0_estimate(source.r0_estimate), R0_series(source.R0_series),
+          case_estimates(source.case_estimates), time(source.time), output_counter(source.output_counter),
+          finished(source.finished), checkpoints(NULL)
+    {
+        source.share();
+        this->shared = source.shared;
+
+        std::unordered_map<const Infectee *, Infectee *> copies;
+        std::vector<Infectee *> &owned = Tracking::track_tree ? source.infected : source.active;
+        for (std::vector<Infectee *>::iterator it = owned.begin(); it != owned.end(); ++it)
+            if (!(*it)->shared)
+                copies[*it] = new Infectee(**it);
+
+        for (std::unordered_map<const Infectee *, Infectee *>::iterator it = copies.begin(); it != copies.end(); ++it)
+        {
+            Infectee *copy = it->second;
+            std::unordered_map<const Infectee *, Infectee *>::iterator infector = copies.find(copy->infector);
+            if (infector != copies.end())
+                copy->infector = infector->second;
+            for (std::vector<Infectee *>::iterator child = copy->infected.begin(); child != copy->infected.end(); ++child)
+                if (!(*child)->shared)
+                    *child = copies[*child];
+        }
+
+        this->infected.reserve(source.infected.size());
+        for (std::vector<Infectee *>::iterator it = source.infected.begin(); it != source.infected.end(); ++it)
+            this->infected.push_back((*it)->shared ? *it : copies[*it]);
+        this->active.reserve(source.active.size());
+        for (std::vector<Infectee *>::iterator it = source.active.begin(); it != source.active.end(); ++it)
+            this->active.push_back(copies[*it]);
+    }
+
+    // Continue a run from a checkpoint written by save (see resume), with its parameters.
+    // Throws std::runtime_error for checkpoints of other kinds of outbreaks.
+    Outbreak(CheckpointReader &in, const Monitor &monitor = Monitor())
+        : monitor(monitor), params(read_header(in)), samplers(this->params), compartments(this->params),
+          pool(this->params.n_threads), line_list(NULL), r0_estimate(this->params), case_estimates(this->params),
+          checkpoints(NULL)
+    {
+        try
+        {
+            this->time = in.get<double>();
+            this->output_counter = in.get<uint>();
+            this->finished = in.get<bool>();
+            this->n_infected = in.get<uint>();
+            this->n_individuals = in.get<uint>();
+            this->is_compartmental = in.get<bool>();
+            this->compartmental_interval = in.get<bool>();
+            std::istringstream state(in.get_string());
+            state >> this->prng;
+            if (state.fail())
+                throw std::runtime_error("Checkpoint of another random-number generator");
+            uint64_t rows = in.get<uint64_t>();
+            uint64_t cols = in.get<uint64_t>();
+            this->counters.resize(rows, cols);
+            in.get_raw(this->counters.data(), rows * cols * sizeof(int));
+            in.get_vector(this->R0_series);
+            in.get_vector(this->retired);
+            this->compartments.load(in);
+            this->r0_estimate.load(in);
+            this->case_estimates.load(in);
+
+            if (Tracking::track_tree) // all individuals by id, the active ones as ids
+            {
+                uint64_t n = in.get<uint64_t>();
+                this->infected.reserve(n);
+                for (uint64_t i = 0; i < n; ++i)
+                    this->infected.push_back(new Infectee(in));
+                for (std::vector<Infectee *>::iterator it = this->infected.begin(); it != this->infected.end(); ++it)
+                {
+                    if ((*it)->infector_id == NO_INFECTOR)
+                        continue;
+                    if ((*it)->infector_id >= n)
+                        throw std::runtime_error("Corrupt checkpoint");
+                    Infectee *infector = this->infected[(*it)->infector_id];
+                    (*it)->infector = infector;
+                    infector->infect(*it); // in order of infection as originally
+                }
+                uint64_t n_active = in.get<uint64_t>();
+                for (uint64_t i = 0; i < n_active; ++i)
+                {
+                    uint id = in.get<uint>();
+                    if (id >= n)
+                        throw std::runtime_error("Corrupt checkpoint");
+                    this->active.push_back(this->infected[id]);
+                }
+            }
+            else
+            {
+                uint64_t n_active = in.get<uint64_t>();
+                for (uint64_t i = 0; i < n_active; ++i)
+                    this->active.push_back(new Infectee(in));
+            }
+        }
+        catch (...)
+        {
+            std::vector<Infectee *> &owned = Tracking::track_tree ? this->infected : this->active;
+            for (std::vector<Infectee *>::iterator it = owned.begin(); it != owned.end(); ++it)
+                delete *it;
+            throw;
+        }
+    }
+
+    // Read the header of a checkpoint, returning its parameters.
+    static params_struct read_header(CheckpointReader &in)
+    {
+        char magic[sizeof(CHECKPOINT_MAGIC)];
+        in.get_raw(magic, sizeof(magic));
+        if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || in.get<uint32_t>() != CHECKPOINT_VERSION)
+            throw std::runtime_error("Not a checkpoint of this version");
+        if (in.get<uint32_t>() != Tracking::track_tree || in.get<uint32_t>() != Output::n_columns)
+            throw std::runtime_error("Checkpoint of another kind of outbreak");
+        return in.get<params_struct>();
+    }
+
+    // Write the state of the run to a checkpoint (see checkpoint.hpp), with `prng` as its
+    // random stream. The monitor and the line list are not included.
+    void save(CheckpointBuffer &out, const Rng &prng) const
+    {
+        out.put_raw(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        out.put(CHECKPOINT_VERSION);
+        out.put(static_cast<uint32_t>(Tracking::track_tree));
+        out.put(static_cast<uint32_t>(Output::n_columns));
+        out.put(this->params);
+        out.put(this->time);
+        out.put(this->output_counter);
+        out.put(this->finished);
+        out.put(this->n_infected);
+        out.put(this->n_individuals);
+        out.put(this->is_compartmental);
+        out.put(this->compartmental_interval);
+        std::ostringstream state;
+        state << prng;
+        out.put_string(state.str());
+        out.put<uint64_t>(this->counters.rows());
+        out.put<uint64_t>(this->counters.cols());
+        out.put_raw(this->counters.data(), this->counters.size() * sizeof(int));
+        out.put_vector(this->R0_series);
+        out.put_vector(this->retired);
+        this->compartments.save(out);
+        this->r0_estimate.save(out);
+        this->case_estimates.save(out);
+
+        if (Tracking::track_tree)
+        {
+            out.put<uint64_t>(this->infected.size());
+            for (std::vector<Infectee *>::const_iterator it = this->infected.begin(); it != this->infected.end(); ++it)
+                (*it)->save(out);
+            out.put<uint64_t>(this->active.size());
+            for (std::vector<Infectee *>::const_iterator it = this->active.begin(); it != this->active.end(); ++it)
+                out.put((*it)->id);
+        }
+        else
+        {
+            out.put<uint64_t>(this->active.size());
+            for (std::vector<Infectee *>::const_iterator it = this->active.begin(); it != this->active.end(); ++it)
+                (*it)->save(out);
+        }
+    }
+
+    // Return a copy of the outbreak continuing exactly as it would (see the copy constructor).
+    Outbreak *snapshot()
+    {
+        return new Outbreak(*this, this->prng);
+    }
+
+    // Return a copy of the outbreak continuing with the random stream `prng`, e.g. for
+    // resampling particles.
+    Outbreak *clone(const Rng &prng)
+    {
+        return new Outbreak(*this, prng);
+    }
+
+    // Continue the run with the own random stream by the time steps up to `until` (the
+    // nearest step), or to its end. Return whether the run is over.
+    bool resume(double until = INFINITY)
+    {
+        this->run(until, this->prng);
+        return this->finished;
+    }
+
+    // Continue the run with the own random stream to its next output step. Return the row of
+    // counters completed there, or -1 once the run is over.
+    int next()
+    {
+        uint row = this->output_counter;
+        this->run(INFINITY, this->prng, true);
+        return (this->output_counter > row) ? static_cast<int>(row) : -1;
+    }
+
+    // Run the time steps up to `until` (the nearest step) drawing from `prng`, writing
+    // checkpoints after the steps they are due. With `to_output`, stop after the next
+    // output step.
+    void run(double until, Rng &prng, bool to_output = false)
+    {
+        const params_struct &params = this->params;
+        while (!this->finished && this->time < until + 0.5 * params.timestep)
+        {
+            double time = this->time;
+            uint &output_counter = this->output_counter;
+            if (time > params.max_time)
+            {
+                this->finished = true;
+                break;
+            }
+            bool is_output_step = std::fmod(time + 1e-9, params.output_interval) < params.timestep;
+
+            if (this->is_compartmental)
+            {
+                double n_new = this->compartments.step(params.timestep, prng);
+                this->n_infected = std::min(this->n_infected + std::floor(n_new + 0.5), 1. * UINT_MAX);
+                this->compartmental_interval = true;
+            }
+            else if (params.tau_leap)
+            {
+                if (is_output_step)
+                    this->template stepIndividuals<true, true>(time, output_counter, prng);
+                else
+                    this->template stepIndividuals<false, true>(time, output_counter, prng);
+            }
+            else
+            {
+                if (is_output_step)
+                    this->template stepIndividuals<true, false>(time, output_counter, prng);
+                else
+                    this->template stepIndividuals<false, false>(time, output_counter, prng);
+            }
+
+            this->r0_estimate.advance(time);
+            if (is_output_step)
+            {
+                Output::add(this->counters, output_counter, this->retired + this->compartments.state_counts());
+                if (this->compartmental_interval) // not followed individually
+                {
+                    this->R0_series[output_counter] = std::nan("");
+                    this->case_estimates.exclude(output_counter);
+                }
+                else
+                    this->R0_series[output_counter] = this->r0_estimate.value();
+                this->compartmental_interval = false;
+                this->monitor.output(time, this->counters, output_counter);
+                output_counter++;
+                if (this->monitor.stop())
+                {
+                    this->monitor.message("Stopped by the monitor.");
+                    this->finished = true;
+                    break;
+                }
+            }
+
+            if (params.hybrid_threshold > 0)
+            {
+                if (!this->is_compartmental && this->active.size() > params.hybrid_threshold)
+                    this->toCompartments(time, prng);
+                else if (this->is_compartmental && this->compartments.n_active() < 0.5 * params.hybrid_threshold)
+                    this->toIndividuals(time, prng);
+            }
+
+            if (this->n_individuals > params.max_infected) // not those in the compartments (see params)
+            {
+                this->monitor.message("Max number of infected individuals reached. Stopping.");
+                this->finished = true;
+                break;
+            }
+            this->time += params.timestep;
+
+            if (this->checkpoints != NULL && this->checkpoints->due(time))
+            {
+                this->save(this->checkpoints->buffer(), prng);
+                this->checkpoints->write();
+            }
+            if (to_output && is_output_step)
+                break;
+        }
+    }
+
+    // Pass the individuals that do not change anymore, i.e. those not active (over or absorbed
+    // by compartments) with all their infectees such, to a block shared with copies. Without
+    // the tree, there are no such individuals kept.
+    void share()
+    {
+        if (!Tracking::track_tree)
+            return;
+        std::unordered_set<const Infectee *> is_active(this->active.begin(), this->active.end());
+        std::shared_ptr<SharedInfectees> block(new SharedInfectees());
+        // infectees after their infectors, so that they are settled first
+        for (std::vector<Infectee *>::reverse_iterator it = this->infected.rbegin(); it != this->infected.rend(); ++it)
+        {
+            if ((*it)->shared || is_active.count(*it) > 0)
+                continue;
+            bool settled = true;
+            for (std::vector<Infectee *>::iterator child = (*it)->infected.begin(); settled && child != (*it)->infected.end(); ++child)
+                settled = (*child)->shared;
+            if (settled)
+            {
+                (*it)->shared = true;
+                block->individuals.push_back(*it);
+            }
+        }
+        if (!block->individuals.empty())
+            this->shared.push_back(block);
+    }
+
+    ~Outbreak()
+    {
+        // need to release these manually as allocated dynamically
+        std::vector<Infectee *> &owned = Tracking::track_tree ? this->infected : this->active;
+        for (std::vector<Infectee *>::iterator it = owned.begin(); it != owned.end(); ++it)
+            if (!(*it)->shared) // else deleted with the last of the shared
+                delete *it;
+    }
+
+    // Advance the active individuals by a time step, dropping those whose infection is over.
+    // Specialized for output steps and tau-leaping to keep the loop free of tests for them.
+    // With params.n_threads > 0, chunks of individuals are stepped in parallel, each with
+    // its own random stream seeded from `prng`, and merged in order.
+    template <bool is_output_step, bool tau_leap>
+    void stepIndividuals(double time, uint output_counter, Rng &prng)
+    {
+        size_t n_active = this->active.size();
+        uint n_chunks = 1;
+        if (this->params.n_threads > 0)
+            n_chunks = std::max<size_t>((n_active + STEP_CHUNK_SIZE - 1) / STEP_CHUNK_SIZE, 1);
+        if (this->chunks.size() < n_chunks)
+            this->chunks.resize(n_chunks);
+
+        if (this->params.n_threads == 0)
+            this->template stepChunk<is_output_step, tau_leap>(0, n_active, time, prng, this->chunks[0]);
+        else
+        {
+            uint64_t seed = random_bits(prng);
+            this->pool.parallel_for(n_chunks, [this, n_active, time, seed](uint c) {
+                Rng chunk_prng(seed + c * 0x9e3779b97f4a7c15ULL);
+                size_t first = c * STEP_CHUNK_SIZE;
+                this->template stepChunk<is_output_step, tau_leap>(first, std::min(first + STEP_CHUNK_SIZE, n_active),
+                                                                   time, chunk_prng, this->chunks[c]);
+            });
+        }
+
+        std::vector<Infectee *>::iterator kept = this->active.begin();
+        for (uint c = 0; c < n_chunks; ++c)
+        {
+            StepChunk &chunk = this->chunks[c];
+            std::vector<Infectee *>::iterator first = this->active.begin() + c * STEP_CHUNK_SIZE;
+            std::vector<Infectee *>::iterator last = this->active.begin() + chunk.kept;
+            kept = (kept == first) ? last : std::move(first, last, kept);
+            this->retired += chunk.retired;
+            if (is_output_step)
+                this->counters.row(output_counter) += chunk.counters.row(0);
+            this->infectious.insert(this->infectious.end(), chunk.infectious.begin(), chunk.infectious.end());
+            this->new_infected.insert(this->new_infected.end(), chunk.new_infected.begin(), chunk.new_infected.end());
+        }
+        this->active.erase(kept, this->active.end());
+
+        if (tau_leap)
+        {
+            this->infectBatch(this->infectious, time, prng, this->new_infected);
+            for (uint c = 0; c < n_chunks; ++c)
+                for (std::vector<Infectee *>::iterator it = this->chunks[c].over.begin(); it != this->chunks[c].over.end(); ++it)
+                    delete *it;
+        }
+
+        if (!this->new_infected.empty()) // append all new infectees from time step
+        {
+            for (std::vector<Infectee *>::iterator it = this->new_infected.begin(); it != this->new_infected.end(); ++it)
+                this->born(*it);
+            if (Tracking::track_tree)
+                this->infected.insert(this->infected.end(), this->new_infected.begin(), this->new_infected.end());
+            this->active.insert(this->active.end(), this->new_infected.begin(), this->new_infected.end());
+            this->new_infected.clear();
+        }
+    }
+
+    // Advance the active individuals from `first` to `last` (indices) by a time step,
+    // moving those to be kept to the front of the range. Touches nothing shared but `active`
+    // within the range, so that chunks can be stepped in parallel.
+    template <bool is_output_step, bool tau_leap>
+    void stepChunk(size_t first, size_t last, double time, Rng &prng, StepChunk &chunk)
+    {
+        chunk.retired = Eigen::ArrayXd::Zero(N_STATES);
+        if (is_output_step)
+        {
+            chunk.counters = Eigen::MatrixXi::Zero(1, Output::n_columns);
+            chunk.states.clear();
+        }
+        chunk.new_infected.clear();
+        chunk.infectious.clear();
+        chunk.over.clear();
+
+        std::vector<Infectee *>::iterator kept = this->active.begin() + first;
+        std::vector<Infectee *>::iterator end = this->active.begin() + last;
+        for (std::vector<Infectee *>::iterator it = this->active.begin() + first; it != end; ++it)
+        {
+            bool infectious = false;
+            if (tau_leap)
+            {
+                infectious = (*it)->advance(time);
+                if (infectious)
+                    chunk.infectious.push_back(*it);
+            }
+            else
+            {
+                Infectee *new_infectee = (*it)->update<Tracking::track_tree>(time, prng, this->samplers);
+                if (new_infectee != NULL)
+                    chunk.new_infected.push_back(new_infectee);
+            }
+
+            if ((*it)->is_over())
+            {
+                chunk.retired[(*it)->istatus()]++;
+                if (!Tracking::track_tree)
+                {
+                    if (infectious) // may still infect in infectBatch
+                        chunk.over.push_back(*it);
+                    else
+                        delete *it;
+                }
+            }
+            else
+            {
+                *kept++ = *it;
+                if (is_output_step)
+                    chunk.states.push_back((*it)->istatus());
+            }
+        }
+        chunk.kept = kept - this->active.begin();
+
+        if (is_output_step) // counted at once by the dispatched kernel
+        {
+            uint32_t state_counts[N_STATES];
+            kernel_count_states(chunk.states.data(), chunk.states.size(), N_STATES, state_counts);
+            Output::add(chunk.counters, 0, Eigen::Map<Eigen::Array<uint32_t, N_STATES, 1> >(state_counts).cast<double>());
+        }
+    }
+
+    // Count a newly infected individual, number it and pass it to the line list.
+    void born(Infectee *infectee)
+    {
+        this->n_infected++;
+        this->r0_estimate.add(infectee->time_infectious_over(), infectee->time_reported(), infectee->infector_infectious_end);
+        this->case_estimates.add(infectee->infection_time, infectee->time_reported(),
+                                 infectee->infector_infection_time, infectee->infector_reported);
+        this->adopt(infectee);
+    }
+
+    // Number an individual and pass it to the line list, without counting it as infected
+    // (e.g. one released from the compartmental approximation, counted there).
+    void adopt(Infectee *infectee)
+    {
+        infectee->id = this->n_individuals++;
+        if (this->line_list != NULL)
+            this->line_list->write(*infectee);
+    }
+
+    // Draw the number of infections by all `infectious` during a time step at once and
+    // assign them to infectors chosen uniformly. For timestep <= infect_delta this is
+    // equivalent to each infecting with probability timestep / infect_delta.
+    void infectBatch(std::vector<Infectee *> &infectious, double time, Rng &prng,
+                     std::vector<Infectee *> &new_infected)
+    {
+        uint n_infectious = infectious.size();
+        if (n_infectious == 0)
+            return;
+        double p_infect = this->params.timestep / this->params.infect_delta;
+        uint n_new;
+        if (p_infect <= 1.)
+        {
+            std::binomial_distribution<uint> binomial(n_infectious, p_infect);
+            n_new = binomial(prng);
+        }
+        else  // several infections per infector possible
+        {
+            std::poisson_distribution<uint> poisson(n_infectious * p_infect);
+            n_new = poisson(prng);
+        }
+
+        for (uint i = 0; i < n_new; ++i)
+        {
+            uint j;
+            if (p_infect <= 1.) // distinct infectors by partial shuffle
+            {
+                std::uniform_int_distribution<uint> unif(i, n_infectious - 1);
+                std::swap(infectious[i], infectious[unif(prng)]);
+                j = i;
+            }
+            else
+            {
+                std::uniform_int_distribution<uint> unif(0, n_infectious - 1);
+                j = unif(prng);
+            }
+            infectious[j]->time_last_infection = time;
+            Infectee *other = new Infectee(infectious[j], time, prng, this->samplers);
+            if (Tracking::track_tree)
+                infectious[j]->infect(other);
+            else
+                other->infector = NULL; // not kept alive
+            new_infected.push_back(other);
+        }
+        infectious.clear();
+    }
+
+    // Continue with the compartmental approximation, absorbing the active individuals.
+    // Tracked absorbed individuals remain in `infected` but are not updated anymore.
+    void toCompartments(double time, Rng &prng)
+    {
+        for (std::vector<Infectee *>::iterator it = this->active.begin(); it != this->active.end(); ++it)
+        {
+            this->compartments.add((*it)->istatus(), (*it)->progress(time), prng);
+            if (!(*it)->released) // as added by born
+                this->r0_estimate.withdraw((*it)->time_infectious_over(), (*it)->time_reported(),
+                                           (*it)->infector_infectious_end);
+            if (!Tracking::track_tree)
+                delete *it;
+        }
+        this->active.clear();
+        this->is_compartmental = true;
+        this->monitor.message("Switching to compartmental model.");
+    }
+
+    // Continue with individuals drawn from the compartmental approximation.
+    void toIndividuals(double time, Rng &prng)
+    {
+        std::vector<Infectee *> released = this->compartments.release(time, prng);
+        for (std::vector<Infectee *>::iterator it = released.begin(); it != released.end(); ++it)
+            this->adopt(*it);
+        if (Tracking::track_tree)
+            this->infected.insert(this->infected.end(), released.begin(), released.end());
+        this->active.insert(this->active.end(), released.begin(), released.end());
+        this->is_compartmental = false;
+        this->monitor.message("Switching to individual-based model.");
+    }
+
+    Eigen::MatrixXi getCounters()
+    {
+        return this->counters;
+    }
+
+    std::vector<Infectee*> getInfected()
+    {
+        return this->infected;
+    }
+
+    float getR0()
+    {
+        // Return the estimate of the basic reproduction number (R0) by the reported
+        // cases due to infectors now past the infectious period (see R0Estimate).
+        return this->r0_estimate.value();
+    }
+
+    Eigen::VectorXd getR0Series()
+    {
+        return this->R0_series;
+    }
+
+    // Print various statistics for debugging.
+    void printStats()
+    {
+        if (!Tracking::track_tree) // periods need the individuals, of which only counts are kept
+        {
+            // outcomes decided so far, counting those still recovering or dying
+            Eigen::ArrayXd counts = this->retired + this->compartments.state_counts();
+            for (std::vector<Infectee *>::iterator it = this->active.begin(); it != this->active.end(); ++it)
+                counts[(*it)->istatus()]++;
+            std::cout.precision(5);
+            std::cout << "Pr(recovery): " << (counts[4] + counts[6]) / (counts[4] + counts[5] + counts[6] + counts[7])
+                      << " Expected " << this->params.p_recovery << std::endl;
+            return;
+        }
+
+        const uint N_GROUPS = 4;
+        Eigen::ArrayXd end_time_sums = Eigen::ArrayXd::Zero(N_GROUPS);
+        Eigen::ArrayXi status_sums = Eigen::ArrayXi::Zero(N_GROUPS);
+        double offset;
+
+        for (std::vector<Infectee *>::iterator it = this->infected.begin(); it != this->infected.end(); ++it)
+        {
+            // handle latent period
+            if ((*it)->status_trajectory[1] == 1)
+                offset = (*it)->end_times[0];
+            else
+                offset = (*it)->end_times[2];
+            end_time_sums[0] += offset - (*it)->infection_time;
+            status_sums[0]++;
+
+            // infectious period
+            end_time_sums[1] += (*it)->end_times[3] - offset;
+            offset = (*it)->end_times[3];
+            status_sums[1]++;
+
+            // recovering period
+            if ((*it)->status_trajectory[3] == 4)
+            {
+                end_time_sums[2] += (*it)->end_times[4] - offset;
+                status_sums[2]++;
+            }
+            else // dying period
+            {
+                end_time_sums[3] += (*it)->end_times[5] - offset;
+                status_sums[3]++;
+            }
+        }
+
+        std::cout.precision(5);
+        std::cout << std::setw(20) << "Means:" << std::setw(20) << "Latent period" 
+                  << std::setw(20) << "Infectious period" << std::setw(20) << "Recovering period" 
+                  << std::setw(20) << "Dying period" << std::endl;
+        std::cout << std::setw(20) << (end_time_sums / status_sums.cast<double>()).transpose() << std::endl;
+        std::cout << std::setw(20) << "Expected:" << std::setw(20) << this->params.latent_period_scale * this->params.latent_period_shape 
+                  << std::setw(20) << this->params.infect_period_scale * this->params.infect_period_shape
+                  << std::setw(20) << this->params.recover_period_scale * this->params.recover_period_shape
+                  << std::setw(20) << this->params.dying_period_scale * this->params.dying_period_shape << std::endl;
+        std::cout << "Pr(recovery): " << (1. * status_sums[2]) / (status_sums[2] + status_sums[3]) 
+                  << " Expected " << this->params.p_recovery << std::endl;
+    }
+};
+
+#endif
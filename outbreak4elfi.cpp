@@ -1,62 +1,917 @@
 #include <boost/python/numpy.hpp>
-#include "outbreak.cpp"
+#include "outbreak.hpp"
+#include "ensemble.hpp"
+#include "tree.hpp"
+#include "summaries.hpp"
+#include "distance.hpp"
+#include "inference.hpp"
+#include "batches.hpp"
+#include "progress.hpp"
+#include <fstream>
+#include <future>
 
 namespace p = boost::python;
 namespace np = boost::python::numpy;
-typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXi;
 
-// simulate a batch of outbreaks each with a different R0
-np::ndarray simulateR0(np::ndarray &py_R0, uint batch_size, uint seed)
+// copy a row-major matrix to a numpy array
+// https://github.com/boostorg/python/issues/97 -> need to copy!
+template <class Matrix>
+np::ndarray to_numpy(const Matrix &matrix)
+{
+    typedef typename Matrix::Scalar Scalar;
+    np::ndarray array = np::from_data(matrix.data(), np::dtype::get_builtin<Scalar>(),
+                                      p::make_tuple(matrix.rows(), matrix.cols()),
+                                      p::make_tuple(sizeof(Scalar) * matrix.cols(), sizeof(Scalar)),
+                                      p::object());
+    return array.copy();
+}
+
+// copy an array-like of numbers to Eigen
+Eigen::VectorXd to_vector(const p::object &array)
+{
+    np::ndarray contiguous = np::from_object(array, np::dtype::get_builtin<double>(), np::ndarray::C_CONTIGUOUS);
+    return Eigen::Map<Eigen::VectorXd>((double *) contiguous.get_data(), p::len(contiguous.reshape(p::make_tuple(-1))));
+}
+
+// set fields of params from a Python dict
+void update_params(params_struct &params, const p::dict &options)
+{
+    p::list keys = options.keys();
+    for (long i = 0; i < p::len(keys); ++i)
+    {
+        std::string name = p::extract<std::string>(keys[i]);
+        if (!set_param(params, name, p::extract<double>(options[keys[i]])))
+        {
+            PyErr_SetString(PyExc_KeyError, ("Unknown parameter: " + name).c_str());
+            p::throw_error_already_set();
+        }
+    }
+}
+
+// releases the GIL while in scope, e.g. for waiting on simulations
+struct ReleaseGIL
+{
+    ReleaseGIL() : state(PyEval_SaveThread()) {}
+    ~ReleaseGIL() { PyEval_RestoreThread(this->state); }
+    PyThreadState *state;
+};
+
+// progress of simulations (see Progress) for Python: its counts as a dict by snapshot(),
+// from any thread, or passed so to `callback` by the thread waiting for the simulations at
+// most every `interval` seconds and once they are over. The simulating threads take no GIL.
+class PyProgress
+{
+  public:
+    PyProgress(const p::object &callback = p::object(), double interval = 0.25)
+        : callback(callback), interval(interval), last_report(-INFINITY) {}
+
+    p::dict snapshot() const
+    {
+        p::dict result;
+        result["total"] = this->counters.total.load(std::memory_order_relaxed);
+        result["done"] = this->counters.done.load(std::memory_order_relaxed);
+        result["redraws"] = this->counters.redraws.load(std::memory_order_relaxed);
+        result["individuals"] = this->counters.individuals.load(std::memory_order_relaxed);
+        result["elapsed"] = this->counters.elapsed();
+        result["eta"] = this->counters.eta();
+        return result;
+    }
+
+    // call the callback if due (or `now`), return false if it raised an error
+    bool report(bool now = false)
+    {
+        double elapsed = this->counters.elapsed();
+        if (this->callback.is_none() || (!now && elapsed < this->last_report + this->interval))
+            return true;
+        this->last_report = elapsed;
+        try
+        {
+            this->callback(this->snapshot());
+        }
+        catch (const p::error_already_set &)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    Progress counters;
+
+  private:
+    p::object callback;
+    double interval;
+    double last_report;
+};
+
+// the Progress of an optional PyProgress argument, NULL for None
+PyProgress *to_progress(const p::object &progress)
+{
+    return progress.is_none() ? NULL : &static_cast<PyProgress &>(p::extract<PyProgress &>(progress));
+}
+
+// Wait for `future` without the GIL, checking for signals (Ctrl-C) every few milliseconds
+// and reporting `progress` if not NULL. On a signal, or an error of the progress callback,
+// cancel `token` if not NULL and raise the error (e.g. KeyboardInterrupt) once the work
+// has stopped.
+template <class Future>
+void waitInterruptible(const Future &future, CancelToken *token = NULL, PyProgress *progress = NULL)
+{
+    while (true)
+    {
+        bool ready;
+        {
+            ReleaseGIL released;
+            ready = future.wait_for(std::chrono::milliseconds(5)) == std::future_status::ready;
+        }
+        if (ready)
+        {
+            if (progress != NULL && !progress->report(true))
+                p::throw_error_already_set();
+            return;
+        }
+        if (PyErr_CheckSignals() != 0 || (progress != NULL && !progress->report()))
+        {
+            if (token != NULL)
+            {
+                token->cancel();
+                ReleaseGIL released;
+                future.wait();
+            }
+            p::throw_error_already_set();
+        }
+    }
+}
+
+// run `work` on another thread, so that Ctrl-C cancels `token` and raises KeyboardInterrupt
+// once the work has stopped, and rethrow its errors
+template <class Work>
+void runInterruptible(const Work &work, CancelToken &token)
+{
+    std::future<void> done = std::async(std::launch::async, work);
+    waitInterruptible(done, &token);
+    done.get();
+}
+
+// simulate reported counts of the listed rows in lockstep, params.ensemble at a time,
+// until each is "exploding" as in simulateReported or `token` expires (checked at each
+// output step), marking the rows done and counting them in progress if not NULL
+void simulateReportedEnsemble(std::mt19937_64 &prng, const params_struct &params, const Eigen::VectorXd &infect_delta,
+                              RowMatrixXi &output, const CancelToken &token, std::vector<uint8_t> &done,
+                              Progress *progress)
+{
+    std::vector<uint> pending;
+    for (uint i = 0; i < infect_delta.size(); ++i)
+        pending.push_back(i);
+
+    while (!pending.empty() && !token.expired())
+    {
+        uint n = std::min<size_t>(params.ensemble, pending.size());
+        std::vector<double> deltas;
+        for (uint j = 0; j < n; ++j)
+            deltas.push_back(infect_delta[pending[j]]);
+        Ensemble ensemble(prng, params, deltas, &token);
+        if (ensemble.cancelled)
+            break;
+
+        std::vector<uint> retry;
+        for (uint j = 0; j < n; ++j)
+        {
+            bool kept = ensemble.counters.row(j).cast<long>().sum() > 10 * output.cols();
+            if (progress != NULL)
+                progress->outbreak(0, kept); // individuals not drawn one by one
+            if (kept)
+            {
+                output.row(pending[j]) = ensemble.counters.row(j);
+                done[pending[j]] = 1;
+            }
+            else
+                retry.push_back(pending[j]);
+        }
+        retry.insert(retry.end(), pending.begin() + n, pending.end());
+        pending.swap(retry);
+    }
+}
+
+// wall-clock limits of a batch in seconds, and its cancellation
+struct BatchLimits
+{
+    BatchLimits(double batch_seconds = INFINITY, double simulation_seconds = INFINITY)
+        : token(batch_seconds), simulation_seconds(simulation_seconds) {}
+
+    CancelToken token;                // of the batch, cancelled on Ctrl-C
+    double simulation_seconds;        // per simulation, incl. its redraws
+    std::vector<uint8_t> done;        // 1 for the rows simulated in full
+};
+
+// simulate a batch of outbreaks each with a different R0 into output, and stats if not NULL,
+// and the distances to observed counts if distance is not NULL. The simulations run on
+// another thread, so that Ctrl-C stops them (raising KeyboardInterrupt) within an output
+// step, as do the limits of the batch. Rows not done hold the counts and estimates of the
+// run cancelled in them, or zero counts (NaN estimates) if none was, and NaN distances.
+// The ensemble takes no limit per simulation. Progress is counted in `progress` if not NULL.
+void simulateBatch(np::ndarray &py_R0, uint batch_size, uint seed, const p::dict &options,
+                   RowMatrixXi &output, BatchStats *stats, const Distance *distance = NULL,
+                   Eigen::VectorXd *distances = NULL, BatchLimits *limits = NULL, PyProgress *progress = NULL)
 {
     std::mt19937_64 prng(seed);
     params_struct params;
+    update_params(params, options);
+    BatchLimits no_limits;
+    if (limits == NULL)
+        limits = &no_limits;
 
     // convert input R0 to Eigen
     Eigen::Map<Eigen::VectorXd> R0((double *) py_R0.get_data(), batch_size);
 
-    // setup output matrix
+    // setup output matrices
     uint n_output = lrint(1. * params.max_time / params.output_interval);
-    RowMatrixXi output(batch_size, n_output);
+    output = RowMatrixXi::Zero(batch_size, n_output);
+    limits->done.assign(batch_size, 0);
+    if (stats != NULL)
+    {
+        uint n_bins = std::ceil(params.max_time / params.histogram_bin);
+        stats->R0 = RowMatrixXd::Constant(batch_size, n_output, std::nan(""));
+        stats->case_R = RowMatrixXd::Constant(batch_size, n_output, std::nan(""));
+        stats->generation_intervals = RowMatrixXi::Zero(batch_size, n_bins);
+        stats->serial_intervals = RowMatrixXi::Zero(batch_size, 2 * n_bins);
+    }
+    if (distance != NULL)
+    {
+        if (distance->size() > n_output)
+        {
+            PyErr_SetString(PyExc_ValueError, "Observed series longer than the simulated one");
+            p::throw_error_already_set();
+        }
+        *distances = Eigen::VectorXd::Constant(batch_size, std::nan(""));
+    }
+    if (params.ensemble > 0 && stats != NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "The ensemble gives reported counts only");
+        p::throw_error_already_set();
+    }
+    if (params.ensemble > 0 && std::isfinite(limits->simulation_seconds))
+    {
+        PyErr_SetString(PyExc_ValueError, "The ensemble has no time limit per simulation");
+        p::throw_error_already_set();
+    }
 
     // mean infectious period
     double mean_inf_period = params.infect_period_shape * params.infect_period_scale;
 
-    Eigen::MatrixXi c;
-    
-    // loop over the batch
-    for (uint i=0; i<batch_size; ++i)
+    Progress *counters = (progress != NULL) ? &progress->counters : NULL;
+    if (counters != NULL)
+        counters->expect(batch_size);
+    std::future<void> simulated = std::async(std::launch::async, [&]() {
+        const CancelToken &token = limits->token;
+        std::vector<uint8_t> &done = limits->done;
+        if (params.ensemble > 0) // replicates in lockstep
+        {
+            Eigen::VectorXd infect_delta = mean_inf_period / R0.array();
+            simulateReportedEnsemble(prng, params, infect_delta, output, token, done, counters);
+            for (uint i = 0; distance != NULL && i < batch_size; ++i)
+                if (done[i])
+                    (*distances)[i] = (*distance)(output.row(i).transpose());
+        }
+        else
+        {
+            // loop over the batch
+            for (uint i = 0; i < batch_size && !token.expired(); ++i)
+            {
+                // setup simulation-specific params
+                params.infect_delta = mean_inf_period / R0[i];
+                CancelToken simulation_token(limits->simulation_seconds, &token);
+
+                if (distance != NULL)
+                {
+                    Cancellable<DistanceMonitor> monitor(simulation_token,
+                                                         DistanceMonitor(*distance, 10. * output.cols()));
+                    done[i] = simulateReported(prng, params, output, i, stats, monitor, counters);
+                    if (done[i])
+                        (*distances)[i] = monitor.value();
+                }
+                else if (params.verbose)
+                {
+                    Cancellable<Verbose> monitor(simulation_token);
+                    done[i] = simulateReported(prng, params, output, i, stats, monitor, counters);
+                }
+                else
+                {
+                    Cancellable<Silent> monitor(simulation_token);
+                    done[i] = simulateReported(prng, params, output, i, stats, monitor, counters);
+                }
+            }
+        }
+        if (counters != NULL) // those cancelled
+            counters->skip(std::count(done.begin(), done.end(), 0));
+    });
+    waitInterruptible(simulated, &limits->token, progress);
+    simulated.get();
+}
+
+// simulate a batch of outbreaks each with a different R0, return the reported counts
+np::ndarray simulateR0(np::ndarray &py_R0, uint batch_size, uint seed, const p::dict &options = p::dict(),
+                       const p::object &progress = p::object())
+{
+    RowMatrixXi output;
+    simulateBatch(py_R0, batch_size, seed, options, output, NULL, NULL, NULL, NULL, to_progress(progress));
+    return to_numpy(output);
+}
+
+// simulate as simulateR0 for at most batch_seconds of wall-clock time and simulation_seconds
+// per simulation, return a dict of the "reported" counts and a boolean array "done" of the
+// simulations run in full (the others stopped by the limits, with the counts so far of
+// the run cancelled, zero if none)
+p::dict simulateR0Within(np::ndarray &py_R0, uint batch_size, uint seed, double batch_seconds,
+                         double simulation_seconds = INFINITY, const p::dict &options = p::dict(),
+                         const p::object &progress = p::object())
+{
+    RowMatrixXi output;
+    BatchLimits limits(batch_seconds, simulation_seconds);
+    simulateBatch(py_R0, batch_size, seed, options, output, NULL, NULL, NULL, &limits, to_progress(progress));
+
+    p::dict result;
+    result["reported"] = to_numpy(output);
+    result["done"] = np::from_data(limits.done.data(), np::dtype::get_builtin<bool>(), p::make_tuple(batch_size),
+                                   p::make_tuple(sizeof(uint8_t)), p::object()).copy();
+    return result;
+}
+
+// simulate as simulateR0, return a dict of the reported counts and further summaries:
+// "R0", "case_R" (per output interval), "generation_interval" (histogram with bins of
+// histogram_bin from 0) and "serial_interval" (from -max_time)
+p::dict simulateR0Stats(np::ndarray &py_R0, uint batch_size, uint seed, const p::dict &options = p::dict(),
+                        const p::object &progress = p::object())
+{
+    RowMatrixXi output;
+    BatchStats stats;
+    simulateBatch(py_R0, batch_size, seed, options, output, &stats, NULL, NULL, NULL, to_progress(progress));
+
+    p::dict result;
+    result["reported"] = to_numpy(output);
+    result["R0"] = to_numpy(stats.R0);
+    result["case_R"] = to_numpy(stats.case_R);
+    result["generation_interval"] = to_numpy(stats.generation_intervals);
+    result["serial_interval"] = to_numpy(stats.serial_intervals);
+    return result;
+}
+
+// simulate as simulateR0, return the summary statistics given by spec (see summaries.hpp)
+np::ndarray simulateR0Summaries(np::ndarray &py_R0, uint batch_size, uint seed, const std::string &spec,
+                                const p::dict &options = p::dict(), const p::object &progress = p::object())
+{
+    RowMatrixXi output;
+    simulateBatch(py_R0, batch_size, seed, options, output, NULL, NULL, NULL, NULL, to_progress(progress));
+    RowMatrixXd stats;
+    Summaries(spec, output.cols()).compute(output, stats);
+    return to_numpy(stats);
+}
+
+// return the summary statistics given by spec of counts, e.g. observed ones
+np::ndarray summarize(const np::ndarray &py_counts, const std::string &spec)
+{
+    if (py_counts.get_nd() != 2)
     {
-        // setup simulation-specific params
-        params.infect_delta = mean_inf_period / R0[i];
+        PyErr_SetString(PyExc_ValueError, "Expected counts as (batch, output steps)");
+        p::throw_error_already_set();
+    }
+    np::ndarray contiguous = py_counts.astype(np::dtype::get_builtin<int>()).copy();
+    RowMatrixXi counts = Eigen::Map<RowMatrixXi>((int *) contiguous.get_data(), contiguous.shape(0), contiguous.shape(1));
+    RowMatrixXd stats;
+    Summaries(spec, counts.cols()).compute(counts, stats);
+    return to_numpy(stats);
+}
+
+// simulate as simulateR0, return the distances to the observed counts of distance, partial
+// (and above its threshold) for the simulations stopped early
+np::ndarray simulateR0Distances(np::ndarray &py_R0, uint batch_size, uint seed, const Distance &distance,
+                                const p::dict &options = p::dict(), const p::object &progress = p::object())
+{
+    RowMatrixXi output;
+    Eigen::VectorXd distances;
+    simulateBatch(py_R0, batch_size, seed, options, output, NULL, &distance, &distances, NULL, to_progress(progress));
+    return to_numpy(RowMatrixXd(distances.transpose())).reshape(p::make_tuple(batch_size));
+}
+
+// Distance from arrays, None for default weights or scales
+boost::shared_ptr<Distance> makeDistance(const p::object &observed, const p::object &weights,
+                                         const p::object &scales, double threshold)
+{
+    Eigen::VectorXd no_values;
+    return boost::shared_ptr<Distance>(new Distance(to_vector(observed),
+                                                    weights.is_none() ? no_values : to_vector(weights),
+                                                    scales.is_none() ? no_values : to_vector(scales), threshold));
+}
+
+// distances of a batch of counts (rows)
+np::ndarray distancesOf(const Distance &distance, const np::ndarray &py_counts)
+{
+    np::ndarray contiguous = py_counts.astype(np::dtype::get_builtin<int>()).copy();
+    RowMatrixXi counts = Eigen::Map<RowMatrixXi>((int *) contiguous.get_data(), contiguous.shape(0), contiguous.shape(1));
+    if (counts.cols() < distance.size())
+    {
+        PyErr_SetString(PyExc_ValueError, "Counts shorter than the observed series");
+        p::throw_error_already_set();
+    }
+    RowMatrixXd distances(1, counts.rows());
+    for (uint i = 0; i < counts.rows(); ++i)
+        distances(0, i) = distance(counts.row(i).transpose());
+    return to_numpy(distances).reshape(p::make_tuple(counts.rows()));
+}
+
+// model of ABC (see inference.hpp) with priors {name: spec} given observed reported counts,
+// with settings "summaries" (a spec of Summaries to compare rather than the counts),
+// "weights" and "scales" (of the distance)
+AbcModel makeAbcModel(const p::object &observed, const p::dict &priors, const p::dict &settings,
+                      const p::dict &options, std::vector<Prior> &prior_list)
+{
+    params_struct params;
+    update_params(params, options);
+
+    std::vector<std::string> names;
+    p::list keys = priors.keys();
+    for (long i = 0; i < p::len(keys); ++i)
+    {
+        std::string name = p::extract<std::string>(keys[i]);
+        names.push_back(name);
+        prior_list.push_back(Prior(name, p::extract<std::string>(priors[keys[i]])));
+    }
+
+    Eigen::VectorXd no_values;
+    return AbcModel(params, names, to_vector(observed).cast<int>(),
+                    p::extract<std::string>(settings.get("summaries", "")),
+                    settings.get("weights").is_none() ? no_values : to_vector(settings["weights"]),
+                    settings.get("scales").is_none() ? no_values : to_vector(settings["scales"]));
+}
 
-        while (true)
+// list of the parameter names of an ABC model
+p::list abcNames(const AbcModel &model)
+{
+    p::list names;
+    for (std::vector<std::string>::const_iterator it = model.names.begin(); it != model.names.end(); ++it)
+        names.append(*it);
+    return names;
+}
+
+// rejection ABC of the parameters with priors {name: spec} given observed reported counts,
+// with settings "n_keep", "threshold" and those of makeAbcModel, return a dict of the
+// parameter "names", kept "samples" (rows) and their "distances". As the other inference
+// below, it runs on another thread, stopped by Ctrl-C (raising KeyboardInterrupt).
+p::dict rejectionABC(const p::object &observed, const p::dict &priors, uint n_samples, uint seed,
+                     const p::dict &settings = p::dict(), const p::dict &options = p::dict())
+{
+    std::vector<Prior> prior_list;
+    AbcModel model = makeAbcModel(observed, priors, settings, options, prior_list);
+    uint n_keep = p::extract<uint>(settings.get("n_keep", 0));
+    double threshold = p::extract<double>(settings.get("threshold", INFINITY));
+    CancelToken token;
+    std::unique_ptr<RejectionABC> run;
+    runInterruptible([&]() { run.reset(new RejectionABC(model, prior_list, n_samples, n_keep, threshold, seed, &token)); },
+                     token);
+    const RejectionABC &abc = *run;
+
+    p::dict result;
+    result["names"] = abcNames(model);
+    result["samples"] = to_numpy(RowMatrixXd(abc.samples));
+    result["distances"] = to_numpy(RowMatrixXd(abc.distances.transpose())).reshape(p::make_tuple(abc.distances.size()));
+    return result;
+}
+
+// ABC-SMC of the parameters with priors {name: spec} given observed reported counts, with
+// settings the fields of smc_struct and those of makeAbcModel, return a dict of the
+// parameter "names", the "particles" (rows) of the last round with their "weights" and
+// "distances", and the "thresholds" and "ess" of the rounds and "n_simulations"
+p::dict abcSMC(const p::object &observed, const p::dict &priors, uint seed, const p::dict &settings = p::dict(),
+               const p::dict &options = p::dict())
+{
+    std::vector<Prior> prior_list;
+    AbcModel model = makeAbcModel(observed, priors, settings, options, prior_list);
+    smc_struct smc;
+    smc.n_particles = p::extract<uint>(settings.get("n_particles", smc.n_particles));
+    smc.n_rounds = p::extract<uint>(settings.get("n_rounds", smc.n_rounds));
+    smc.quantile = p::extract<double>(settings.get("quantile", smc.quantile));
+    smc.min_threshold = p::extract<double>(settings.get("min_threshold", smc.min_threshold));
+    smc.ess_fraction = p::extract<double>(settings.get("ess_fraction", smc.ess_fraction));
+    smc.max_attempts = p::extract<uint>(settings.get("max_attempts", smc.max_attempts));
+    CancelToken token;
+    std::unique_ptr<AbcSMC> run;
+    runInterruptible([&]() { run.reset(new AbcSMC(model, prior_list, smc, seed, &token)); }, token);
+    const AbcSMC &abc = *run;
+
+    p::dict result;
+    uint n = abc.weights.size();
+    result["names"] = abcNames(model);
+    result["particles"] = to_numpy(RowMatrixXd(abc.particles));
+    result["weights"] = to_numpy(RowMatrixXd(abc.weights.transpose())).reshape(p::make_tuple(n));
+    result["distances"] = to_numpy(RowMatrixXd(abc.distances.transpose())).reshape(p::make_tuple(n));
+    p::list thresholds, ess;
+    for (uint r = 0; r < abc.thresholds.size(); ++r)
+    {
+        thresholds.append(abc.thresholds[r]);
+        ess.append(abc.ess[r]);
+    }
+    result["thresholds"] = thresholds;
+    result["ess"] = ess;
+    result["n_simulations"] = abc.n_simulations;
+    return result;
+}
+
+// bootstrap particle filter of observed reported counts with R0 (see inference.hpp), with
+// settings "n_particles" and "reporting" (a spec of Reporting, needed), return a dict of the
+// "log_likelihood" estimate and the "ess" and "mean_reported" per observed step
+p::dict particleFilter(const p::object &observed, double R0, uint seed, const p::dict &settings = p::dict(),
+                       const p::dict &options = p::dict())
+{
+    params_struct params;
+    update_params(params, options);
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / R0;
+    if (!settings.has_key("reporting"))
+    {
+        PyErr_SetString(PyExc_KeyError, "No reporting in settings");
+        p::throw_error_already_set();
+    }
+    Eigen::VectorXi counts = to_vector(observed).cast<int>();
+    std::string spec = p::extract<std::string>(settings["reporting"]);
+    Reporting reporting(spec);
+    uint n_particles = p::extract<uint>(settings.get("n_particles", 1000));
+    CancelToken token;
+    std::unique_ptr<ParticleFilter> run;
+    runInterruptible([&]() { run.reset(new ParticleFilter(params, counts, reporting, n_particles, seed, &token)); },
+                     token);
+    const ParticleFilter &filter = *run;
+
+    p::dict result;
+    uint n = filter.ess.size();
+    result["log_likelihood"] = filter.log_likelihood;
+    result["ess"] = to_numpy(RowMatrixXd(filter.ess.transpose())).reshape(p::make_tuple(n));
+    result["mean_reported"] = to_numpy(RowMatrixXd(filter.mean_reported.transpose())).reshape(p::make_tuple(n));
+    return result;
+}
+
+// particle MCMC of the parameters with priors {name: spec} given observed reported counts,
+// starting from {name: initial} with random walk steps {name: sd}, with settings the fields
+// of pmcmc_struct (reporting needed), return a dict of the parameter "names", the "chain" (rows), its
+// "log_likelihoods" and the "acceptance" rate
+p::dict particleMCMC(const p::object &observed, const p::dict &priors, const p::dict &initial, const p::dict &steps,
+                     uint seed, const p::dict &settings = p::dict(), const p::dict &options = p::dict())
+{
+    params_struct params;
+    update_params(params, options);
+    std::vector<Prior> prior_list;
+    p::list keys = priors.keys();
+    Eigen::VectorXd x(p::len(keys)), sd(p::len(keys));
+    for (long i = 0; i < p::len(keys); ++i)
+    {
+        std::string name = p::extract<std::string>(keys[i]);
+        prior_list.push_back(Prior(name, p::extract<std::string>(priors[keys[i]])));
+        if (!initial.has_key(keys[i]) || !steps.has_key(keys[i]))
         {
-            Outbreak ob(prng, params);
-            c = ob.getCounters();
-            output.row(i) = c.rowwise().sum() - c.col(0) - c.col(2);
+            PyErr_SetString(PyExc_KeyError, ("No initial value or step of " + name).c_str());
+            p::throw_error_already_set();
+        }
+        x[i] = p::extract<double>(initial[keys[i]]);
+        sd[i] = p::extract<double>(steps[keys[i]]);
+    }
+    pmcmc_struct pmcmc;
+    pmcmc.n_particles = p::extract<uint>(settings.get("n_particles", pmcmc.n_particles));
+    pmcmc.n_iterations = p::extract<uint>(settings.get("n_iterations", pmcmc.n_iterations));
+    pmcmc.reporting = p::extract<std::string>(settings.get("reporting", pmcmc.reporting));
+    Eigen::VectorXi counts = to_vector(observed).cast<int>();
+    CancelToken token;
+    std::unique_ptr<ParticleMCMC> run;
+    runInterruptible([&]() { run.reset(new ParticleMCMC(params, prior_list, x, sd, counts, pmcmc, seed, &token)); },
+                     token);
+    const ParticleMCMC &mcmc = *run;
+
+    p::dict result;
+    uint n = mcmc.log_likelihoods.size();
+    p::list names;
+    for (std::vector<Prior>::iterator it = prior_list.begin(); it != prior_list.end(); ++it)
+        names.append(it->name);
+    result["names"] = names;
+    result["chain"] = to_numpy(RowMatrixXd(mcmc.chain));
+    result["log_likelihoods"] = to_numpy(RowMatrixXd(mcmc.log_likelihoods.transpose())).reshape(p::make_tuple(n));
+    result["acceptance"] = (n > 0) ? (1. * mcmc.n_accepted) / n : 0.;
+    return result;
+}
+
+// simulate an outbreak writing its line list to a binary file (see linelist.hpp),
+// return the number of infected individuals
+uint exportLineList(const std::string &path, double R0, uint seed, const p::dict &options = p::dict())
+{
+    std::mt19937_64 prng(seed);
+    params_struct params;
+    update_params(params, options);
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / R0;
+
+    LineListWriter line_list(path);
+    Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> ob(prng, params, &line_list);
+    line_list.close();
+    return ob.n_infected;
+}
+
+// an outbreak with R0 advanced from Python an output interval at a time, as an iterator
+// of dicts of the "step" (row of counters), its "time", the state "counts" then (see
+// StateCounts), "n_infected", "n_active" and the "R0" estimate
+class SteppedOutbreak
+{
+  public:
+    typedef Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> Engine;
+
+    SteppedOutbreak(double R0, uint seed, const p::dict &options = p::dict())
+    {
+        params_struct params;
+        update_params(params, options);
+        params.infect_delta = params.infect_period_shape * params.infect_period_scale / R0;
+        std::mt19937_64 prng(seed);
+        this->engine.reset(new Engine(prng, params, NULL, Silent(), false));
+    }
+
+    p::dict next()
+    {
+        int row = this->engine->next();
+        if (row < 0)
+        {
+            PyErr_SetString(PyExc_StopIteration, "Outbreak over");
+            p::throw_error_already_set();
+        }
+        p::dict result;
+        result["step"] = row;
+        result["time"] = (row + 1) * this->engine->params.output_interval;
+        result["counts"] = to_numpy(RowMatrixXi(this->engine->counters.row(row))).reshape(p::make_tuple(-1));
+        result["n_infected"] = this->engine->n_infected;
+        result["n_active"] = this->engine->active.size();
+        result["R0"] = this->engine->R0_series[row];
+        return result;
+    }
+
+    // state counts of the output steps so far (rows)
+    np::ndarray counters() const
+    {
+        return to_numpy(RowMatrixXi(this->engine->counters.topRows(this->engine->output_counter)));
+    }
+
+    bool finished() const
+    {
+        return this->engine->finished;
+    }
+
+  private:
+    std::unique_ptr<Engine> engine;
+};
+
+p::object steppedIter(p::object self)
+{
+    return self;
+}
+
+// a batch submitted to a BatchQueue, keeping its output buffers and progress alive
+struct PendingBatch
+{
+    std::shared_future<void> future;
+    p::object output;
+    np::ndarray kept = np::empty(p::make_tuple(0), np::dtype::get_builtin<bool>()); // rows kept (see BatchJob)
+    p::object progress;              // PyProgress or None
+    std::shared_ptr<CancelToken> token; // of the batch, outliving it
 
-            // Consider only "exploding" outbreak simulations (note effect on prng)
-            if ((uint) output.row(i).sum() > 10 * n_output)
-                break;
+    bool done() const
+    {
+        return this->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // stop the batch within an output step, leaving the rows not kept (see BatchJob)
+    void cancel()
+    {
+        this->token->cancel();
+    }
+
+    // wait for the batch, return its output (reported counts as simulateR0); Ctrl-C cancels
+    // the batch and raises KeyboardInterrupt once it has stopped, with the rows kept so far
+    // in `kept`
+    p::object wait() const
+    {
+        waitInterruptible(this->future, this->token.get(), to_progress(this->progress));
+        this->future.get(); // rethrows errors of the batch
+        return this->output;
+    }
+};
+
+// batches of simulateR0 submitted without waiting (see BatchQueue), writing to preallocated
+// int32 arrays of (batch, output steps), with a boolean array "kept" of the rows kept (the
+// others out of redraws or cancelled, e.g. by deleting the queue)
+class PyBatchQueue
+{
+  public:
+    PyBatchQueue(uint n_threads = 1) : queue(new BatchQueue(n_threads)) {}
+
+    ~PyBatchQueue()
+    {
+        ReleaseGIL released;
+        this->queue.reset(); // cancelling the batches not finished, before their buffers are released
+    }
+
+    PendingBatch submit(const p::object &R0, uint seed, np::ndarray output, const p::dict &options = p::dict(),
+                        const p::object &progress = p::object())
+    {
+        PyProgress *reporting = to_progress(progress);
+        params_struct params;
+        update_params(params, options);
+        Eigen::VectorXd values = to_vector(R0);
+        if (output.get_nd() != 2 || output.shape(0) != values.size() || output.shape(1) != BatchQueue::n_output(params)
+            || output.get_dtype() != np::dtype::get_builtin<int>()
+            || !(output.get_flags() & np::ndarray::C_CONTIGUOUS) || !(output.get_flags() & np::ndarray::WRITEABLE))
+        {
+            PyErr_SetString(PyExc_ValueError, "Expected output as a writeable C-contiguous int32 array of (batch, output steps)");
+            p::throw_error_already_set();
         }
+
+        // forget the finished batches, whose buffers are no longer written
+        std::vector<PendingBatch> running;
+        for (std::vector<PendingBatch>::iterator it = this->submitted.begin(); it != this->submitted.end(); ++it)
+            if (!it->done())
+                running.push_back(*it);
+        this->submitted.swap(running);
+
+        PendingBatch batch;
+        batch.kept = np::zeros(p::make_tuple(values.size()), np::dtype::get_builtin<bool>());
+        batch.token = std::make_shared<CancelToken>();
+        batch.future = this->queue->submit(params, values, seed, (int *) output.get_data(),
+                                           (uint8_t *) batch.kept.get_data(),
+                                           (reporting != NULL) ? &reporting->counters : NULL, batch.token.get());
+        batch.output = output;
+        batch.progress = progress;
+        this->submitted.push_back(batch);
+        return batch;
+    }
+
+    size_t pending()
+    {
+        return this->queue->pending();
     }
 
-    // convert output to numpy array
-    // https://github.com/boostorg/python/issues/97 -> need to copy!
-    np::ndarray py_output = np::from_data(output.data(), np::dtype::get_builtin<int>(),
-                                          p::make_tuple(batch_size, n_output), 
-                                          p::make_tuple(sizeof(int)*n_output, sizeof(int)),
-                                          p::object());
+    // output steps per simulation with options
+    uint n_output(const p::dict &options = p::dict())
+    {
+        params_struct params;
+        update_params(params, options);
+        return BatchQueue::n_output(params);
+    }
+
+  private:
+    std::vector<PendingBatch> submitted; // destroyed after the queue
+    std::unique_ptr<BatchQueue> queue;
+};
+
+
+// numpy dtype of LineListRecord (see linelist.hpp)
+np::dtype lineListDtype()
+{
+    p::dict fields;
+    fields["names"] = p::make_tuple("id", "infector", "infection_time", "end_times", "symptom", "outcome");
+    fields["formats"] = p::make_tuple("<u4", "<u4", "<f8", "(4,)<f8", "u1", "u1");
+    fields["offsets"] = p::make_tuple(offsetof(LineListRecord, id), offsetof(LineListRecord, infector),
+                                      offsetof(LineListRecord, infection_time), offsetof(LineListRecord, end_times),
+                                      offsetof(LineListRecord, symptom), offsetof(LineListRecord, outcome));
+    fields["itemsize"] = sizeof(LineListRecord);
+    return np::dtype(fields);
+}
 
-    // std::cout << "Final: " << std::endl << output << std::endl;
-    // std::cout << "Py: " << p::extract<char const*>(p::str(py_output)) << std::endl;
-    return py_output.copy();
+// read-only numpy view of the records from `first` to `last` of a mapped line list,
+// keeping `self` (the LineList) alive
+np::ndarray lineListView(p::object self, uint64_t first, uint64_t last)
+{
+    const LineListReader &reader = p::extract<const LineListReader &>(self);
+    return np::from_data(reader.begin() + first, lineListDtype(), p::make_tuple(last - first),
+                         p::make_tuple(sizeof(LineListRecord)), self);
+}
+
+// all records of a line list
+np::ndarray lineListRecords(p::object self)
+{
+    const LineListReader &reader = p::extract<const LineListReader &>(self);
+    return lineListView(self, 0, reader.size());
+}
+
+// records of a line list infected in [start, stop)
+np::ndarray lineListTimeRange(p::object self, double start, double stop)
+{
+    const LineListReader &reader = p::extract<const LineListReader &>(self);
+    uint64_t first = reader.lower_bound(start);
+    return lineListView(self, first, std::max(first, reader.lower_bound(stop)));
+}
+
+// ids of the infected of `id` in a line list
+np::ndarray lineListChildren(p::object self, uint64_t id)
+{
+    const LineListReader &reader = p::extract<const LineListReader &>(self);
+    if (id >= reader.size())
+    {
+        PyErr_SetString(PyExc_IndexError, "No such id");
+        p::throw_error_already_set();
+    }
+    const uint32_t *first = reader.children_begin(id);
+    return np::from_data(first, np::dtype::get_builtin<uint32_t>(), p::make_tuple(reader.children_end(id) - first),
+                         p::make_tuple(sizeof(uint32_t)), self);
+}
+
+// iterate over the records of a line list
+p::object lineListIter(p::object self)
+{
+    return lineListRecords(self).attr("__iter__")();
+}
+
+
+// write the transmission tree of a line list as Newick or GraphML (see tree.hpp),
+// return the number of sampled individuals
+template <bool graphml>
+uint64_t lineListTree(const LineListReader &reader, const std::string &path, double p_tips = 1.,
+                      double time = INFINITY, uint seed = 0)
+{
+    TreeWriter tree(reader, p_tips, time, seed);
+    std::ofstream os(path.c_str());
+    if (graphml)
+        tree.graphml(os);
+    else
+        tree.newick(os);
+    if (!os)
+    {
+        PyErr_SetString(PyExc_IOError, ("Cannot write " + path).c_str());
+        p::throw_error_already_set();
+    }
+    return tree.n_sampled();
+}
+
+uint64_t lineListNewick(const LineListReader &reader, const std::string &path, double p_tips = 1.,
+                        double time = INFINITY, uint seed = 0)
+{
+    return lineListTree<false>(reader, path, p_tips, time, seed);
+}
+
+uint64_t lineListGraphML(const LineListReader &reader, const std::string &path, double p_tips = 1.,
+                         double time = INFINITY, uint seed = 0)
+{
+    return lineListTree<true>(reader, path, p_tips, time, seed);
 }
 
+BOOST_PYTHON_FUNCTION_OVERLOADS(simulateR0_overloads, simulateR0, 3, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(simulateR0Within_overloads, simulateR0Within, 4, 7)
+BOOST_PYTHON_FUNCTION_OVERLOADS(simulateR0Stats_overloads, simulateR0Stats, 3, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(simulateR0Summaries_overloads, simulateR0Summaries, 4, 6)
+BOOST_PYTHON_FUNCTION_OVERLOADS(simulateR0Distances_overloads, simulateR0Distances, 4, 6)
+BOOST_PYTHON_FUNCTION_OVERLOADS(rejectionABC_overloads, rejectionABC, 4, 6)
+BOOST_PYTHON_FUNCTION_OVERLOADS(abcSMC_overloads, abcSMC, 3, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(particleFilter_overloads, particleFilter, 3, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(particleMCMC_overloads, particleMCMC, 5, 7)
+BOOST_PYTHON_FUNCTION_OVERLOADS(exportLineList_overloads, exportLineList, 3, 4)
+BOOST_PYTHON_FUNCTION_OVERLOADS(lineListNewick_overloads, lineListNewick, 2, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(lineListGraphML_overloads, lineListGraphML, 2, 5)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(submit_overloads, PyBatchQueue::submit, 3, 5)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(n_output_overloads, PyBatchQueue::n_output, 0, 1)
 
 BOOST_PYTHON_MODULE(outbreak4elfi)
 {
     Py_Initialize();
     np::initialize();
-    boost::python::def("simulateR0", &simulateR0);
+    boost::python::def("simulateR0", &simulateR0, simulateR0_overloads());
+    boost::python::def("simulateR0Within", &simulateR0Within, simulateR0Within_overloads());
+    boost::python::def("simulateR0Stats", &simulateR0Stats, simulateR0Stats_overloads());
+    boost::python::def("simulateR0Summaries", &simulateR0Summaries, simulateR0Summaries_overloads());
+    boost::python::def("summarize", &summarize);
+    boost::python::def("simulateR0Distances", &simulateR0Distances, simulateR0Distances_overloads());
+    boost::python::class_<Distance, boost::shared_ptr<Distance> >("Distance", p::no_init)
+        .def("__init__", p::make_constructor(&makeDistance, p::default_call_policies(),
+                                             (p::arg("observed"), p::arg("weights") = p::object(),
+                                              p::arg("scales") = p::object(), p::arg("threshold") = INFINITY)))
+        .def("__call__", &distancesOf)
+        .def_readwrite("threshold", &Distance::threshold);
+    boost::python::def("rejectionABC", &rejectionABC, rejectionABC_overloads());
+    boost::python::def("abcSMC", &abcSMC, abcSMC_overloads());
+    boost::python::def("particleFilter", &particleFilter, particleFilter_overloads());
+    boost::python::def("particleMCMC", &particleMCMC, particleMCMC_overloads());
+    boost::python::def("exportLineList", &exportLineList, exportLineList_overloads());
+    boost::python::class_<SteppedOutbreak, boost::noncopyable>("SteppedOutbreak",
+                                                               p::init<double, uint, p::optional<p::dict> >())
+        .def("__iter__", &steppedIter)
+        .def("__next__", &SteppedOutbreak::next)
+        .def("counters", &SteppedOutbreak::counters)
+        .add_property("finished", &SteppedOutbreak::finished);
+    boost::python::class_<PyProgress, boost::noncopyable>("Progress", p::init<p::optional<p::object, double> >())
+        .def("snapshot", &PyProgress::snapshot);
+    boost::python::class_<PendingBatch>("Batch", p::no_init)
+        .def("done", &PendingBatch::done)
+        .def("wait", &PendingBatch::wait)
+        .def("cancel", &PendingBatch::cancel)
+        .add_property("kept", p::make_getter(&PendingBatch::kept, p::return_value_policy<p::return_by_value>()));
+    boost::python::class_<PyBatchQueue, boost::noncopyable>("BatchQueue", p::init<p::optional<uint> >())
+        .def("submit", &PyBatchQueue::submit, submit_overloads())
+        .def("pending", &PyBatchQueue::pending)
+        .def("n_output", &PyBatchQueue::n_output, n_output_overloads());
+    boost::python::def("kernel_isa", &kernel_isa);
+    boost::python::class_<LineListReader, boost::noncopyable>("LineList", p::init<std::string>())
+        .def("__len__", &LineListReader::size)
+        .def("__iter__", &lineListIter)
+        .def("records", &lineListRecords)
+        .def("timeRange", &lineListTimeRange)
+        .def("children", &lineListChildren)
+        .def("newick", &lineListNewick, lineListNewick_overloads())
+        .def("graphml", &lineListGraphML, lineListGraphML_overloads());
 }
@@ -0,0 +1,53 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+
+// Progress of batches of simulations, counted by the threads running them with atomic
+// counters, without locks, and read from any thread, e.g. for reporting to Python while
+// the simulations run. Counts accumulate over the batches given the same Progress.
+class Progress
+{
+    public:
+        Progress() : start(std::chrono::steady_clock::now()), total(0), done(0), redraws(0), individuals(0) {}
+        Progress(const Progress &) = delete;
+        Progress &operator=(const Progress &) = delete;
+
+        void expect(uint64_t n)            // Add n simulations to be run.
+        {
+            this->total.fetch_add(n, std::memory_order_relaxed);
+        }
+        void outbreak(uint64_t n_individuals, bool kept) // Count a simulated outbreak, kept or to be redrawn.
+        {
+            this->individuals.fetch_add(n_individuals, std::memory_order_relaxed);
+            (kept ? this->done : this->redraws).fetch_add(1, std::memory_order_relaxed);
+        }
+        void skip(uint64_t n)              // Count n expected simulations not run (e.g. cancelled).
+        {
+            this->total.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+        double elapsed() const             // Return the seconds since construction.
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+        }
+        double eta() const                 // Return the estimated seconds left, NaN before any is done.
+        {
+            uint64_t done = this->done.load(std::memory_order_relaxed);
+            uint64_t total = this->total.load(std::memory_order_relaxed);
+            if (done == 0)
+                return std::nan("");
+            return (total > done) ? this->elapsed() * (total - done) / done : 0.;
+        }
+
+        const std::chrono::steady_clock::time_point start;
+        std::atomic<uint64_t> total;       // simulations expected
+        std::atomic<uint64_t> done;        // simulations kept
+        std::atomic<uint64_t> redraws;     // simulations redrawn (not "exploding")
+        std::atomic<uint64_t> individuals; // individuals drawn over all simulations
+};
+
+#endif
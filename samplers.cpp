@@ -0,0 +1,79 @@
+// Contains the set up of samplers for random variates.
+
+#include <math.h>
+
+#include "samplers.hpp"
+
+const ZigguratTables ZIGGURAT;
+
+ZigguratTables::ZigguratTables()
+{
+    // Set up the tables as in Marsaglia and Tsang (2000).
+    const double m1 = 2147483648.; // 2^31
+    const double m2 = 4294967296.; // 2^32
+
+    double dn = ZIGGURAT_NORMAL_R, tn = dn, vn = 9.91256303526217e-3;
+    double q = vn / exp(-0.5 * dn * dn);
+    this->kn[0] = static_cast<uint32_t>((dn / q) * m1);
+    this->kn[1] = 0;
+    this->wn[0] = q / m1;
+    this->wn[127] = dn / m1;
+    this->fn[0] = 1.;
+    this->fn[127] = exp(-0.5 * dn * dn);
+    for (int i = 126; i >= 1; --i)
+    {
+        dn = sqrt(-2. * log(vn / dn + exp(-0.5 * dn * dn)));
+        this->kn[i + 1] = static_cast<uint32_t>((dn / tn) * m1);
+        tn = dn;
+        this->fn[i] = exp(-0.5 * dn * dn);
+        this->wn[i] = dn / m1;
+    }
+
+    double de = ZIGGURAT_EXPONENTIAL_R, te = de, ve = 3.949659822581572e-3;
+    q = ve / exp(-de);
+    this->ke[0] = static_cast<uint32_t>((de / q) * m2);
+    this->ke[1] = 0;
+    this->we[0] = q / m2;
+    this->we[255] = de / m2;
+    this->fe[0] = 1.;
+    this->fe[255] = exp(-de);
+    for (int i = 254; i >= 1; --i)
+    {
+        de = -log(ve / de + exp(-de));
+        this->ke[i + 1] = static_cast<uint32_t>((de / te) * m2);
+        te = de;
+        this->fe[i] = exp(-de);
+        this->we[i] = de / m2;
+    }
+}
+
+GammaSampler::GammaSampler(double shape, double scale) : alpha(shape), theta(scale)
+{
+    this->k = 0;
+    this->d = this->c = 0.;
+    if (shape == 1.)
+        this->method = EXPONENTIAL;
+    else if (shape == floor(shape) && shape <= ERLANG_MAX_SHAPE)
+    {
+        this->method = ERLANG;
+        this->k = static_cast<uint>(shape);
+    }
+    else
+    {
+        this->method = (shape > 1.) ? MARSAGLIA_TSANG : BOOSTED;
+        this->d = ((shape > 1.) ? shape : shape + 1.) - 1. / 3.;
+        this->c = 1. / sqrt(9. * this->d);
+    }
+}
+
+double GammaSampler::shape() const
+{
+    // Return the shape parameter.
+    return this->alpha;
+}
+
+double GammaSampler::scale() const
+{
+    // Return the scale parameter.
+    return this->theta;
+}
@@ -0,0 +1,225 @@
+#ifndef SAMPLERS_H
+#define SAMPLERS_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <stdint.h>
+#include <algorithm>
+
+#include "kernels.hpp"
+
+typedef unsigned int uint;
+
+const uint ERLANG_MAX_SHAPE = 3; // integer shapes up to this are sampled as Erlang (see benchmark.cpp)
+
+// Return 64 random bits from a generator with a range of 64 or 32 bits.
+template <class Rng>
+inline uint64_t random_bits(Rng &prng)
+{
+    if (Rng::max() - Rng::min() == 0xffffffffffffffffULL)
+        return prng() - Rng::min();
+    static_assert(Rng::max() - Rng::min() >= 0xffffffffULL, "need a generator of at least 32 bits");
+    uint64_t high = static_cast<uint64_t>(prng() - Rng::min()) << 32;
+    return high | ((prng() - Rng::min()) & 0xffffffffULL);
+}
+
+// Return a uniform variate in [0, 1) from the top 53 of 64 random bits.
+inline double bits_to_uniform(uint64_t bits)
+{
+    return (bits >> 11) * (1. / 9007199254740992.);
+}
+
+// Return a uniform variate in [0, 1).
+template <class Rng>
+inline double uniform01(Rng &prng)
+{
+    return bits_to_uniform(random_bits(prng));
+}
+
+// Tables of the ziggurat method for the standard normal (128 layers) and exponential
+// (256 layers) distributions. Marsaglia and Tsang (2000), J. Stat. Softw. 5(8).
+// The layer is chosen by the low bits of a 64-bit draw and the position within the
+// layer by the independent high 32 bits.
+struct ZigguratTables
+{
+    ZigguratTables();
+    uint32_t kn[128];  // acceptance limits
+    double wn[128];    // widths
+    double fn[128];    // density at the layer edges
+    uint32_t ke[256];
+    double we[256];
+    double fe[256];
+};
+
+extern const ZigguratTables ZIGGURAT;
+const double ZIGGURAT_NORMAL_R = 3.442619855899;      // start of the normal tail
+const double ZIGGURAT_EXPONENTIAL_R = 7.697117470131487; // start of the exponential tail
+
+template <class Rng>
+double normal01_fix(Rng &prng, int32_t hz, uint iz); // Handle the rejections of normal01.
+template <class Rng>
+double exponential01_fix(Rng &prng, uint32_t jz, uint iz); // Handle the rejections of exponential01.
+
+// Return a standard normal variate.
+template <class Rng>
+inline double normal01(Rng &prng)
+{
+    uint64_t bits = random_bits(prng);
+    int32_t hz = static_cast<int32_t>(bits >> 32);
+    uint iz = bits & 127;
+    if (static_cast<uint32_t>(std::abs(static_cast<int64_t>(hz))) < ZIGGURAT.kn[iz])
+        return hz * ZIGGURAT.wn[iz];
+    return normal01_fix(prng, hz, iz);
+}
+
+// Return a unit exponential variate.
+template <class Rng>
+inline double exponential01(Rng &prng)
+{
+    uint64_t bits = random_bits(prng);
+    uint32_t jz = static_cast<uint32_t>(bits >> 32);
+    uint iz = bits & 255;
+    if (jz < ZIGGURAT.ke[iz])
+        return jz * ZIGGURAT.we[iz];
+    return exponential01_fix(prng, jz, iz);
+}
+
+template <class Rng>
+double normal01_fix(Rng &prng, int32_t hz, uint iz)
+{
+    // Handle the rejections of normal01: the base strip with the tail, or the wedges.
+    while (true)
+    {
+        double x = hz * ZIGGURAT.wn[iz];
+        if (iz == 0)
+        {
+            double y;
+            do
+            {
+                x = -std::log(1. - uniform01(prng)) / ZIGGURAT_NORMAL_R;
+                y = -std::log(1. - uniform01(prng));
+            } while (y + y < x * x);
+            return (hz > 0) ? ZIGGURAT_NORMAL_R + x : -ZIGGURAT_NORMAL_R - x;
+        }
+        if (ZIGGURAT.fn[iz] + uniform01(prng) * (ZIGGURAT.fn[iz - 1] - ZIGGURAT.fn[iz]) < std::exp(-0.5 * x * x))
+            return x;
+
+        uint64_t bits = random_bits(prng);
+        hz = static_cast<int32_t>(bits >> 32);
+        iz = bits & 127;
+        if (static_cast<uint32_t>(std::abs(static_cast<int64_t>(hz))) < ZIGGURAT.kn[iz])
+            return hz * ZIGGURAT.wn[iz];
+    }
+}
+
+template <class Rng>
+double exponential01_fix(Rng &prng, uint32_t jz, uint iz)
+{
+    // Handle the rejections of exponential01: the base strip with the tail, or the wedges.
+    while (true)
+    {
+        if (iz == 0)
+            return ZIGGURAT_EXPONENTIAL_R - std::log(1. - uniform01(prng));
+        double x = jz * ZIGGURAT.we[iz];
+        if (ZIGGURAT.fe[iz] + uniform01(prng) * (ZIGGURAT.fe[iz - 1] - ZIGGURAT.fe[iz]) < std::exp(-x))
+            return x;
+
+        uint64_t bits = random_bits(prng);
+        jz = static_cast<uint32_t>(bits >> 32);
+        iz = bits & 255;
+        if (jz < ZIGGURAT.ke[iz])
+            return jz * ZIGGURAT.we[iz];
+    }
+}
+
+// Fill `out` with `n` uniform variates in [0, 1), for batch sampling.
+template <class Rng>
+void uniform01_batch(Rng &prng, double *out, size_t n)
+{
+    const size_t CHUNK = 256;
+    uint64_t bits[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK)
+    {
+        size_t m = std::min(CHUNK, n - i);
+        for (size_t j = 0; j < m; ++j)
+            bits[j] = random_bits(prng);
+        kernel_bits_to_uniform(bits, out + i, m);
+    }
+}
+
+// Gamma-distributed variates with the fastest exact algorithm for the shape chosen once:
+// exponential for shape 1, Erlang (sum of exponentials) for small integer shapes,
+// Marsaglia-Tsang for other shapes above 1 and Marsaglia-Tsang boosted by a power of
+// a uniform for shapes below 1. Normal and exponential variates come from ziggurats.
+class GammaSampler
+{
+    public:
+        GammaSampler(double shape = 1., double scale = 1.);
+
+        template <class Rng>
+        double operator()(Rng &prng) const; // Draw a variate.
+
+        double shape() const;               // Return the shape parameter.
+        double scale() const;               // Return the scale parameter.
+
+    private:
+        enum Method { EXPONENTIAL, ERLANG, MARSAGLIA_TSANG, BOOSTED };
+        Method method;
+        double alpha;                       // shape
+        double theta;                       // scale
+        uint k;                             // shape as integer for ERLANG
+        double d, c;                        // constants of Marsaglia-Tsang
+
+        template <class Rng>
+        double marsaglia_tsang(Rng &prng) const; // Draw a unit-scale variate with shape above 1.
+};
+
+template <class Rng>
+inline double GammaSampler::marsaglia_tsang(Rng &prng) const
+{
+    // Draw a unit-scale variate with shape above 1 (the boosted shape for BOOSTED).
+    // Marsaglia and Tsang (2000), ACM Trans. Math. Softw. 26(3), 363-372.
+    while (true)
+    {
+        double x = normal01(prng);
+        double v = 1. + this->c * x;
+        if (v <= 0.)
+            continue;
+        v = v * v * v;
+        double u = uniform01(prng);
+        double x2 = x * x;
+        if (u < 1. - 0.0331 * x2 * x2)
+            return this->d * v;
+        if (std::log(u) < 0.5 * x2 + this->d * (1. - v + std::log(v)))
+            return this->d * v;
+    }
+}
+
+template <class Rng>
+inline double GammaSampler::operator()(Rng &prng) const
+{
+    // Draw a variate.
+    switch (this->method)
+    {
+    case EXPONENTIAL:
+        return this->theta * exponential01(prng);
+    case ERLANG:
+    {
+        double sum = exponential01(prng);
+        for (uint i = 1; i < this->k; ++i)
+            sum += exponential01(prng);
+        return this->theta * sum;
+    }
+    case MARSAGLIA_TSANG:
+        return this->theta * this->marsaglia_tsang(prng);
+    default: // BOOSTED
+    {
+        double boosted = this->marsaglia_tsang(prng);
+        return this->theta * boosted * std::exp(-exponential01(prng) / this->alpha); // U^(1/alpha)
+    }
+    }
+}
+
+#endif
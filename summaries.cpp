@@ -0,0 +1,146 @@
+// Contains the implementation for the summary statistics of reported counts.
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include "kernels.hpp"
+#include "summaries.hpp"
+
+Summaries::Summaries(const std::string &spec, uint n_output) : n_output(n_output), n_stats(0)
+{
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        Kernel kernel;
+        kernel.arg = (colon == std::string::npos) ? 1 : std::atoi(item.c_str() + colon + 1);
+        kernel.column = this->n_stats;
+        uint width = 1;
+        if (name == "counts") { kernel.type = COUNTS; width = n_output; }
+        else if (name == "log_counts") { kernel.type = LOG_COUNTS; width = n_output; }
+        else if (name == "total") kernel.type = TOTAL;
+        else if (name == "log_total") kernel.type = LOG_TOTAL;
+        else if (name == "peak") kernel.type = PEAK;
+        else if (name == "growth") kernel.type = GROWTH;
+        else if (name == "ratio") kernel.type = RATIO;
+        else if (name == "acf") kernel.type = ACF;
+        else throw std::invalid_argument("Unknown summary statistic: " + item);
+        if (kernel.arg < 1 && (kernel.type == RATIO || kernel.type == ACF))
+            throw std::invalid_argument("Lag must be positive: " + item);
+        this->kernels.push_back(kernel);
+        this->n_stats += width;
+    }
+}
+
+uint Summaries::size() const
+{
+    // Return the number of statistics.
+    return this->n_stats;
+}
+
+void Summaries::compute(const RowMatrixXi &counts, RowMatrixXd &stats) const
+{
+    // Compute a row of statistics per row of counts. Kernels of single output steps run
+    // over the batch (columns); those depending on the steps with cases go by row, with the
+    // sums of their segments by the dispatched kernels (see kernels.hpp).
+    uint n_rows = counts.rows();
+    stats.resize(n_rows, this->n_stats);
+    RowMatrixXd C = counts.cast<double>();
+    RowMatrixXd N(n_rows, this->n_output); // new cases
+    for (uint r = 0; r < n_rows; ++r)
+        kernel_differences(C.row(r).data(), this->n_output, N.row(r).data());
+
+    // output steps with cases: [first, last]
+    Eigen::VectorXi first(n_rows), last(n_rows);
+    for (uint r = 0; r < n_rows; ++r)
+    {
+        first[r] = this->n_output;
+        last[r] = -1;
+        for (uint w = 0; w < this->n_output; ++w)
+        {
+            if (counts(r, w) > 0)
+            {
+                first[r] = std::min<int>(first[r], w);
+                last[r] = w;
+            }
+        }
+    }
+
+    Eigen::ArrayXd x, y; // scratch space for a segment
+    double mean, var;
+    for (std::vector<Kernel>::const_iterator k = this->kernels.begin(); k != this->kernels.end(); ++k)
+    {
+        switch (k->type)
+        {
+        case COUNTS:
+            stats.middleCols(k->column, this->n_output) = C;
+            break;
+        case LOG_COUNTS:
+            stats.middleCols(k->column, this->n_output) = (C.array() + 1.).log().matrix();
+            break;
+        case TOTAL:
+            stats.col(k->column) = C.rowwise().maxCoeff();
+            break;
+        case LOG_TOTAL:
+            stats.col(k->column) = (C.rowwise().maxCoeff().array() + 1.).log().matrix();
+            break;
+        case PEAK:
+            for (uint r = 0; r < n_rows; ++r)
+            {
+                Eigen::Index peak = 0;
+                if (last[r] >= 0)
+                    N.row(r).segment(0, last[r] + 1).maxCoeff(&peak);
+                stats(r, k->column) = peak;
+            }
+            break;
+        case GROWTH: // least-squares slope
+            for (uint r = 0; r < n_rows; ++r)
+            {
+                int n = last[r] - first[r] + 1;
+                if (n < 2)
+                {
+                    stats(r, k->column) = std::nan("");
+                    continue;
+                }
+                y = (N.row(r).segment(first[r], n).array() + 1.).log().transpose();
+                x = Eigen::ArrayXd::LinSpaced(n, 0, n - 1) - 0.5 * (n - 1);
+                stats(r, k->column) = kernel_dot(x.data(), y.data(), n) / kernel_dot(x.data(), x.data(), n);
+            }
+            break;
+        case RATIO: // as in Ebola_ELFI_R0.ipynb
+            for (uint r = 0; r < n_rows; ++r)
+            {
+                int start = std::max(first[r] + 2, 3);
+                int n = last[r] + 1 - k->arg - start;
+                if (n < 1)
+                {
+                    stats(r, k->column) = std::nan("");
+                    continue;
+                }
+                y = (C.row(r).segment(start + k->arg, n).array() / C.row(r).segment(start, n).array()).transpose();
+                stats(r, k->column) = kernel_sum(y.data(), n) / n;
+            }
+            break;
+        case ACF:
+            for (uint r = 0; r < n_rows; ++r)
+            {
+                int n = last[r] - first[r] + 1 - k->arg;
+                if (n < 1)
+                {
+                    stats(r, k->column) = std::nan("");
+                    continue;
+                }
+                y = N.row(r).segment(first[r], n + k->arg).array().transpose();
+                kernel_mean_var(y.data(), n + k->arg, &mean, &var);
+                y -= mean;
+                stats(r, k->column) = (var > 0.) ? kernel_dot(y.data(), y.data() + k->arg, n) / (var * (n + k->arg))
+                                                 : std::nan("");
+            }
+            break;
+        }
+    }
+}
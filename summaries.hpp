@@ -0,0 +1,47 @@
+#ifndef SUMMARIES_H
+#define SUMMARIES_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+typedef unsigned int uint;
+typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXi;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+// Summary statistics of the reported counts of a batch of simulations (a row of counts per
+// output step for each), computed by kernels chosen by a comma-separated spec of names with
+// an optional integer argument, e.g. "ratio:2,log_total,peak". Counts are cumulative and end
+// where they drop to zero (simulations stopped at max_infected); new cases are differences.
+//
+//   counts       the counts themselves (a column per output step)
+//   log_counts   log(1 + counts) (a column per output step)
+//   total        the final count
+//   log_total    log(1 + total)
+//   peak         output step with the most new cases
+//   growth       slope of log(1 + new cases) over the output steps with cases
+//   ratio:lag    mean ratio of counts lag steps apart, skipping the first steps with cases
+//   acf:lag      autocorrelation of new cases at lag over the output steps with cases
+class Summaries
+{
+    public:
+        Summaries(const std::string &spec, uint n_output); // Throws std::invalid_argument for unknown names.
+
+        uint size() const;                 // Return the number of statistics.
+        void compute(const RowMatrixXi &counts, RowMatrixXd &stats) const; // Compute a row of statistics per row of counts.
+
+    private:
+        enum Type { COUNTS, LOG_COUNTS, TOTAL, LOG_TOTAL, PEAK, GROWTH, RATIO, ACF };
+        struct Kernel
+        {
+            Type type;
+            int arg;
+            uint column;                   // first column in the statistics
+        };
+
+        uint n_output;
+        uint n_stats;
+        std::vector<Kernel> kernels;
+};
+
+#endif
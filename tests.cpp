@@ -0,0 +1,1063 @@
+/*
+Check properties of the simulation that its approximations and shortcuts must keep.
+
+Each check prints its name and the values compared, and the program exits with the
+number of failed checks.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <math.h>
+
+#include "batches.hpp"
+#include "cancel.hpp"
+#include "checkpoint.hpp"
+#include "distance.hpp"
+#include "ensemble.hpp"
+#include "inference.hpp"
+#include "kernels.hpp"
+#include "linelist.hpp"
+#include "outbreak.hpp"
+#include "progress.hpp"
+#include "samplers.hpp"
+#include "summaries.hpp"
+#include "tree.hpp"
+
+// Print the result of a check and return whether it failed.
+bool failed(const std::string &name, bool ok, double value, double expected)
+{
+    std::cout << (ok ? "ok     " : "FAILED ") << name << ": " << value << " (expected " << expected << ")"
+              << std::endl;
+    return !ok;
+}
+
+// Return the Kolmogorov-Smirnov statistic, times the square root of the sample size, of the
+// sample `x` and the distribution function `cdf`; below 1.63 with probability 0.99.
+double ks_statistic(std::vector<double> x, double (*cdf)(double))
+{
+    std::sort(x.begin(), x.end());
+    double n = x.size(), d = 0.;
+    for (size_t i = 0; i < x.size(); ++i)
+        d = std::max(d, std::max(cdf(x[i]) - i / n, (i + 1) / n - cdf(x[i])));
+    return d * sqrt(n);
+}
+
+double normal_cdf(double x)
+{
+    return 0.5 * erfc(-x / sqrt(2.));
+}
+
+double exponential_cdf(double x)
+{
+    return -expm1(-x);
+}
+
+// The ziggurat normal and exponential variates follow their distributions.
+int check_ziggurats()
+{
+    std::mt19937_64 prng(1);
+    std::vector<double> normal(1000000), exponential(1000000);
+    for (size_t i = 0; i < normal.size(); ++i)
+    {
+        normal[i] = normal01(prng);
+        exponential[i] = exponential01(prng);
+    }
+    double d_normal = ks_statistic(normal, normal_cdf);
+    double d_exponential = ks_statistic(exponential, exponential_cdf);
+    return failed("ziggurat normal KS statistic", d_normal < 1.63, d_normal, 1.63)
+           + failed("ziggurat exponential KS statistic", d_exponential < 1.63, d_exponential, 1.63);
+}
+
+// Return whether x and y are equal up to rounding relative to `scale`.
+bool close(double x, double y, double scale)
+{
+    return std::abs(x - y) <= 1e-12 * scale;
+}
+
+// The dispatched kernels equal scalar loops, for lengths around multiples of the vector width.
+int check_kernels()
+{
+    std::mt19937_64 prng(1);
+    int n_failed = 0;
+    bool uniform_ok = true, due_ok = true, infectious_ok = true, below_ok = true, states_ok = true;
+    bool sum_ok = true, dot_ok = true, mean_var_ok = true, differences_ok = true;
+    for (size_t n : {0, 1, 3, 4, 5, 7, 8, 9, 17, 64, 1003})
+    {
+        std::vector<uint64_t> bits(n);
+        std::vector<double> x(n), y(n), p(N_STATES), out(n);
+        std::vector<uint8_t> states(n), marks(n);
+        std::vector<uint32_t> groups(n), counts(N_STATES);
+        for (size_t i = 0; i < n; ++i)
+        {
+            bits[i] = random_bits(prng);
+            x[i] = 10. * uniform01(prng) - 2.;
+            y[i] = 10. * uniform01(prng) - 2.;
+            states[i] = random_bits(prng) % (N_STATES + 1); // one beyond the states counted
+            groups[i] = states[i] % N_STATES;
+        }
+        for (uint s = 0; s < N_STATES; ++s)
+            p[s] = s / (N_STATES - 1.);
+
+        kernel_bits_to_uniform(bits.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            uniform_ok = uniform_ok && out[i] == (bits[i] >> 11) * std::ldexp(1., -53);
+        kernel_mark_due(x.data(), n, 3., marks.data());
+        for (size_t i = 0; i < n; ++i)
+            due_ok = due_ok && marks[i] == (3. >= x[i]);
+        kernel_mark_infectious(states.data(), n, marks.data());
+        for (size_t i = 0; i < n; ++i)
+            infectious_ok = infectious_ok && marks[i] == (states[i] == 2 || states[i] == 3);
+        kernel_mark_below(x.data(), groups.data(), p.data(), n, marks.data());
+        for (size_t i = 0; i < n; ++i)
+            below_ok = below_ok && marks[i] == (x[i] < p[groups[i]]);
+        kernel_count_states(states.data(), n, N_STATES, counts.data());
+        for (uint s = 0; s < N_STATES; ++s)
+            states_ok = states_ok && counts[s] == std::count(states.begin(), states.end(), s);
+
+        double sum = 0., dot = 0., scale = 0., squares = 0., mean, var;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += x[i];
+            dot += x[i] * y[i];
+            scale += std::abs(x[i] * y[i]) + std::abs(x[i]);
+        }
+        double expected_mean = (n > 0) ? sum / n : 0.;
+        for (size_t i = 0; i < n; ++i)
+            squares += (x[i] - expected_mean) * (x[i] - expected_mean);
+        sum_ok = sum_ok && close(kernel_sum(x.data(), n), sum, scale);
+        dot_ok = dot_ok && close(kernel_dot(x.data(), y.data(), n), dot, scale);
+        kernel_mean_var(x.data(), n, &mean, &var);
+        mean_var_ok = mean_var_ok && close(mean, expected_mean, scale) && close(var, (n > 0) ? squares / n : 0., scale * 10.);
+        kernel_differences(x.data(), n, out.data());
+        for (size_t i = 0; i < n; ++i)
+            differences_ok = differences_ok && out[i] == ((i > 0) ? x[i] - x[i - 1] : x[0]);
+    }
+    std::string isa = std::string(" (") + kernel_isa() + ")";
+    n_failed += failed("kernel_bits_to_uniform" + isa, uniform_ok, uniform_ok, 1);
+    n_failed += failed("kernel_mark_due" + isa, due_ok, due_ok, 1);
+    n_failed += failed("kernel_mark_infectious" + isa, infectious_ok, infectious_ok, 1);
+    n_failed += failed("kernel_mark_below" + isa, below_ok, below_ok, 1);
+    n_failed += failed("kernel_count_states" + isa, states_ok, states_ok, 1);
+    n_failed += failed("kernel_sum" + isa, sum_ok, sum_ok, 1);
+    n_failed += failed("kernel_dot" + isa, dot_ok, dot_ok, 1);
+    n_failed += failed("kernel_mean_var" + isa, mean_var_ok, mean_var_ok, 1);
+    n_failed += failed("kernel_differences" + isa, differences_ok, differences_ok, 1);
+    return n_failed;
+}
+
+// GammaSampler has the mean and variance of its shape and scale, with each of its methods.
+int check_gamma_sampler()
+{
+    const double shapes[] = {0.5, 1., 2., 3.7, 10.};
+    const uint n = 1000000;
+    int n_failed = 0;
+    for (double shape : shapes)
+    {
+        GammaSampler gamma(shape, 2.);
+        std::mt19937_64 prng(1);
+        double sum = 0., sum2 = 0.;
+        for (uint i = 0; i < n; ++i)
+        {
+            double x = gamma(prng);
+            sum += x;
+            sum2 += x * x;
+        }
+        double mean = sum / n, var = sum2 / n - mean * mean;
+        std::ostringstream name;
+        name << "gamma shape " << shape;
+        n_failed += failed(name.str() + " mean", fabs(mean - 2. * shape) < 0.01 * 2. * shape, mean, 2. * shape);
+        n_failed += failed(name.str() + " variance", fabs(var - 4. * shape) < 0.02 * 4. * shape, var, 4. * shape);
+    }
+    return n_failed;
+}
+
+// Return whether two series are equal, with NaN equal to NaN.
+bool same_series(const Eigen::VectorXd &a, const Eigen::VectorXd &b)
+{
+    return a.size() == b.size() && (a.array() == b.array() || (a.array() != a.array() && b.array() != b.array())).all();
+}
+
+// Runs stepping individuals in parallel have the same results for any number of threads.
+int check_threads()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    int n_failed = 0;
+    for (int tau_leap = 0; tau_leap < 2; ++tau_leap)
+    {
+        params.tau_leap = tau_leap;
+        params.n_threads = 1;
+        uint seed = tau_leap ? 5 : 2; // seeds with the outbreak taking off
+        std::mt19937_64 prng(seed);
+        Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> one(prng, params);
+        for (uint n_threads = 2; n_threads <= 4; n_threads *= 2)
+        {
+            params.n_threads = n_threads;
+            std::mt19937_64 prng(seed);
+            Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> ob(prng, params);
+            bool ok = ob.counters == one.counters && same_series(ob.getR0Series(), one.getR0Series());
+            std::ostringstream name;
+            name << "infected with " << n_threads << " threads" << (tau_leap ? " (tau leap)" : "");
+            n_failed += failed(name.str(), ok && one.n_infected > STEP_CHUNK_SIZE, ob.n_infected, one.n_infected);
+        }
+    }
+    return n_failed;
+}
+
+// A clone given the random stream of its source continues as the source.
+template <class Tracking>
+bool check_clone(const std::string &name)
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 20000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, Tracking, Silent, StateCounts> ob(prng, params, NULL, Silent(), false);
+    ob.resume(100.);
+    Outbreak<std::mt19937_64, Tracking, Silent, StateCounts> *clone = ob.clone(ob.prng);
+    ob.resume();
+    clone->resume();
+    bool ok = clone->counters == ob.counters && same_series(clone->getR0Series(), ob.getR0Series());
+    bool result = failed("clone continuing " + name, ok, clone->n_infected, ob.n_infected);
+    delete clone;
+    return result;
+}
+
+// A run resumed from a checkpoint continues as the run saved.
+template <class Tracking>
+bool check_checkpoint(const std::string &name)
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 20000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, Tracking, Silent, StateCounts> ob(prng, params, NULL, Silent(), false);
+    ob.resume(100.);
+    CheckpointBuffer buffer;
+    ob.save(buffer, ob.prng);
+    CheckpointReader in(buffer.bytes);
+    Outbreak<std::mt19937_64, Tracking, Silent, StateCounts> resumed(in);
+    ob.resume();
+    resumed.resume();
+    bool ok = resumed.counters == ob.counters && same_series(resumed.getR0Series(), ob.getR0Series());
+    return failed("checkpoint resumed " + name, ok, resumed.n_infected, ob.n_infected);
+}
+
+// A run stepped by output steps has the rows of a run at once, one per step.
+bool check_stepping()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 20000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> ob(prng, params, NULL, Silent(), false);
+    Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> stepped(prng, params, NULL, Silent(), false);
+    ob.resume();
+    int row, expected = 0;
+    bool ok = true;
+    while ((row = stepped.next()) >= 0)
+        ok = ok && row == expected++;
+    ok = ok && stepped.counters == ob.counters && stepped.output_counter == ob.output_counter;
+    return failed("rows stepped", ok, expected, ob.output_counter);
+}
+
+// Batches run in the background have the same results for any number of threads, and
+// only "exploding" outbreaks.
+int check_batches()
+{
+    params_struct params;
+    params.max_infected = 20000;
+    uint n_output = BatchQueue::n_output(params);
+    Eigen::VectorXd R0(6);
+    R0 << 1.5, 2., 2.5, 1.5, 2., 2.5;
+    std::vector<int> one(R0.size() * n_output), many(R0.size() * n_output);
+    std::vector<uint8_t> one_kept(R0.size()), many_kept(R0.size());
+    BatchQueue serial(1), parallel(3);
+    std::shared_future<void> first = serial.submit(params, R0, 7, one.data(), one_kept.data());
+    std::shared_future<void> second = parallel.submit(params, R0, 7, many.data(), many_kept.data());
+    first.get();
+    second.get();
+    long min_total = INT_MAX;
+    for (uint i = 0; i < R0.size(); ++i)
+        min_total = std::min(min_total, Eigen::Map<Eigen::VectorXi>(&one[i * n_output], n_output).cast<long>().sum());
+    bool ok = one == many && one_kept == many_kept && std::count(one_kept.begin(), one_kept.end(), 1) == R0.size();
+    int n_failed = failed("batches with 3 threads", ok && serial.pending() == 0 && min_total > 10 * n_output, min_total,
+                          10 * n_output);
+
+    // subcritical rows are given up after MAX_REDRAWS, and a queue deleted with batches
+    // running cancels them
+    Eigen::VectorXd subcritical(2);
+    subcritical << 0.05, 2.;
+    std::vector<int> output(subcritical.size() * n_output);
+    std::vector<uint8_t> kept(subcritical.size());
+    Progress progress;
+    serial.submit(params, subcritical, 1, output.data(), kept.data(), &progress).get();
+    n_failed += failed("subcritical batch rows given up", kept[0] == 0 && kept[1] == 1 && progress.total == 1,
+                       progress.redraws, MAX_REDRAWS);
+
+    params.max_time = 7000.;
+    params.max_infected = UINT_MAX;
+    Eigen::VectorXd critical = Eigen::VectorXd::Constant(8, 1.);
+    std::vector<int> long_output(critical.size() * BatchQueue::n_output(params));
+    std::vector<uint8_t> long_kept(critical.size(), 1);
+    std::shared_future<void> cancelled;
+    {
+        BatchQueue queue(2);
+        cancelled = queue.submit(params, critical, 1, long_output.data(), long_kept.data());
+        queue.submit(params, critical, 2, long_output.data(), long_kept.data());
+    }
+    bool ready = cancelled.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    n_failed += failed("batches cancelled with their queue", ready, std::count(long_kept.begin(), long_kept.end(), 0),
+                       critical.size());
+
+    // as on Ctrl-C in Python, a batch with a subcritical row cancelled by its token
+    CancelToken token;
+    critical[0] = 0.05;
+    BatchQueue queue(2);
+    std::shared_future<void> interrupted = queue.submit(params, critical, 3, long_output.data(), long_kept.data(), NULL,
+                                                        &token);
+    token.cancel();
+    interrupted.get();
+    n_failed += failed("batch cancelled by its token", long_kept[0] == 0 && queue.pending() == 0,
+                       std::count(long_kept.begin(), long_kept.end(), 0), critical.size());
+    return n_failed;
+}
+
+// Progress counts each simulation of a batch done, and the individuals drawn.
+int check_progress()
+{
+    params_struct params;
+    params.max_infected = 20000;
+    Eigen::VectorXd R0 = Eigen::VectorXd::Constant(8, 2.);
+    std::vector<int> output(R0.size() * BatchQueue::n_output(params));
+    std::vector<uint8_t> kept(R0.size());
+    Progress progress;
+    {
+        BatchQueue queue(2);
+        queue.submit(params, R0, 3, output.data(), kept.data(), &progress).get();
+    }
+    bool ok = progress.total == 8 && progress.eta() == 0. && progress.individuals >= 8 * 20000;
+    return failed("simulations counted done", ok, progress.done, 8);
+}
+
+// Return the bytes of the file at `path`.
+std::vector<char> read_file(const std::string &path)
+{
+    std::ifstream is(path.c_str(), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string &path, const std::vector<char> &bytes)
+{
+    std::ofstream os(path.c_str(), std::ios::binary);
+    os.write(bytes.data(), bytes.size());
+}
+
+// Return whether the child index of `reader` lists each record with an infector under it,
+// in order of id.
+bool consistent_children(const LineListReader &reader)
+{
+    uint64_t n_children = 0, n_with_infector = 0;
+    for (uint64_t id = 0; id < reader.size(); ++id)
+    {
+        n_with_infector += reader[id].infector < reader.size();
+        for (const uint32_t *child = reader.children_begin(id); child != reader.children_end(id); ++child)
+        {
+            if (reader[*child].infector != id || (child != reader.children_begin(id) && *child <= child[-1]))
+                return false;
+            n_children++;
+        }
+    }
+    return n_children == n_with_infector;
+}
+
+// Return whether the records of `reader` are those of the infected of `ob` (with the tree
+// tracked) of the same ids.
+template <class Outbreak>
+bool same_records(const LineListReader &reader, const Outbreak &ob)
+{
+    bool ok = reader.size() <= ob.infected.size();
+    for (typename std::vector<Infectee *>::const_iterator it = ob.infected.begin(); ok && it != ob.infected.end(); ++it)
+    {
+        const Infectee &infectee = **it;
+        if (infectee.get_id() >= reader.size())
+            continue;
+        const LineListRecord &record = reader[infectee.get_id()];
+        ok = record.id == infectee.get_id() && record.infector == infectee.get_infector_id()
+             && record.infection_time == infectee.time_infected()
+             && record.end_times[record.symptom == 1 ? 0 : 1] == infectee.time_reported()
+             && std::max(record.end_times[1], record.end_times[2]) == infectee.time_infectious_over();
+    }
+    return ok;
+}
+
+// The line list of a run has a record of each infected individual, with its id, infector
+// and times, also when read while the file is being written, up to the records on disk.
+int check_line_list_records()
+{
+    const std::string path = "tests_linelist_records.bin";
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 20000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    LineListWriter writer(path);
+    Outbreak<std::mt19937_64, TrackTree, Silent, StateCounts> ob(prng, params, &writer, Silent(), false);
+    int n_failed = 0;
+
+    bool ok = true;
+    uint64_t n_partial = 0;
+    while (ob.next() >= 0)
+    {
+        LineListReader partial(path);
+        ok = ok && partial.size() <= writer.size() && same_records(partial, ob) && consistent_children(partial);
+        if (partial.size() > 0 && partial.size() < writer.size())
+            n_partial++;
+    }
+    n_failed += failed("line list read while written", ok && n_partial > 0, n_partial, 1);
+
+    writer.close();
+    LineListReader reader(path);
+    n_failed += failed("line list records", reader.size() == ob.infected.size() && same_records(reader, ob),
+                       reader.size(), ob.infected.size());
+    std::remove(path.c_str());
+    return n_failed;
+}
+
+// A line list written during a run reads back with its child index and time ranges, also
+// when truncated or with a corrupt index, and is refused with a corrupt header.
+int check_line_list_reader()
+{
+    const std::string path = "tests_linelist.bin", copy = "tests_linelist_copy.bin";
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 20000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    LineListWriter writer(path);
+    Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> ob(prng, params, &writer);
+    writer.close();
+    int n_failed = 0;
+
+    {
+        LineListReader reader(path);
+        bool ok = reader.size() == ob.n_individuals && consistent_children(reader);
+        for (uint64_t id = 0; id < reader.size(); ++id)
+            ok = ok && reader[id].id == id && (id == 0 || reader[id].infection_time >= reader[id - 1].infection_time);
+        n_failed += failed("line list read back", ok, reader.size(), ob.n_individuals);
+
+        ok = true;
+        for (double time = 0.; time < reader[reader.size() - 1].infection_time + 2.; time += 3.7)
+        {
+            uint64_t first = reader.lower_bound(time);
+            ok = ok && (first == reader.size() || reader[first].infection_time >= time)
+                 && (first == 0 || reader[first - 1].infection_time < time);
+        }
+        n_failed += failed("line list time ranges", ok, ok, 1);
+    }
+
+    std::vector<char> bytes = read_file(path);
+    uint64_t n_kept = ob.n_individuals / 2;
+    write_file(copy, std::vector<char>(bytes.begin(), bytes.begin() + sizeof(LineListHeader)
+                                                      + n_kept * sizeof(LineListRecord) + 10));
+    {
+        LineListReader truncated(copy);
+        n_failed += failed("truncated line list", truncated.size() == n_kept && consistent_children(truncated),
+                           truncated.size(), n_kept);
+    }
+
+    std::vector<char> corrupt = bytes;
+    const LineListHeader *header = reinterpret_cast<const LineListHeader *>(bytes.data());
+    uint64_t *offsets = reinterpret_cast<uint64_t *>(corrupt.data() + header->csr_offset);
+    offsets[ob.n_individuals] = UINT64_MAX / 8;
+    write_file(copy, corrupt);
+    {
+        LineListReader rebuilt(copy);
+        n_failed += failed("line list with a corrupt index", consistent_children(rebuilt), rebuilt.size(),
+                           ob.n_individuals);
+    }
+
+    corrupt = bytes;
+    reinterpret_cast<LineListHeader *>(corrupt.data())->header_size = corrupt.size() + 64;
+    write_file(copy, corrupt);
+    bool refused = false;
+    try
+    {
+        LineListReader reader(copy);
+    }
+    catch (const std::runtime_error &)
+    {
+        refused = true;
+    }
+    write_file(copy, std::vector<char>(bytes.begin(), bytes.begin() + sizeof(LineListHeader) / 2));
+    try
+    {
+        LineListReader reader(copy);
+        refused = false;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    n_failed += failed("line lists with a corrupt header refused", refused, refused, 1);
+    std::remove(path.c_str());
+    std::remove(copy.c_str());
+    return n_failed;
+}
+
+// Write a line list without child index of individuals infected by `infectors` at
+// `infection_times`, each reported at the given time.
+void write_line_list(const std::string &path, const std::vector<uint> &infectors,
+                     const std::vector<double> &infection_times, const std::vector<double> &report_times)
+{
+    LineListHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LINE_LIST_MAGIC, sizeof(header.magic));
+    header.version = LINE_LIST_VERSION;
+    header.header_size = sizeof(LineListHeader);
+    header.record_size = sizeof(LineListRecord);
+    header.n_records = infectors.size();
+    std::vector<LineListRecord> records(infectors.size());
+    std::memset(records.data(), 0, records.size() * sizeof(LineListRecord));
+    for (size_t id = 0; id < records.size(); ++id)
+    {
+        records[id].id = id;
+        records[id].infector = infectors[id];
+        records[id].infection_time = infection_times[id];
+        records[id].symptom = 1; // reported at the end of latency
+        records[id].outcome = 4;
+        records[id].end_times[0] = report_times[id];
+        records[id].end_times[1] = records[id].end_times[2] = records[id].end_times[3] = report_times[id] + 10.;
+    }
+    std::ofstream os(path.c_str(), std::ios::binary);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(LineListRecord));
+}
+
+// Transmission trees of known line lists: a whole small tree, its tips subsampled by report
+// time, and a chain deeper than recursion would allow.
+int check_trees()
+{
+    const std::string path = "tests_tree.bin";
+    int n_failed = 0;
+    write_line_list(path, {NO_INFECTOR, 0, 0, 1}, {0., 1., 2., 4.}, {10., 10., 3., 5.});
+    {
+        LineListReader lines(path);
+        std::ostringstream whole, subsampled, graph;
+        TreeWriter(lines).newick(whole);
+        std::string expected = "((3:3)1:1,2:2)0;\n";
+        n_failed += failed("Newick tree", whole.str() == expected, whole.str().size(), expected.size());
+
+        TreeWriter sampler(lines, 1., 5.);
+        sampler.newick(subsampled);
+        n_failed += failed("subsampled Newick tree", subsampled.str() == "(3:4,2:2)0;\n", sampler.n_sampled(), 2);
+        sampler.graphml(graph);
+        std::string xml = graph.str();
+        bool ok = xml.find("<node id=\"n1\"") == std::string::npos && xml.find("source=\"n0\" target=\"n3\"") != std::string::npos
+                  && xml.find("source=\"n0\" target=\"n2\"") != std::string::npos;
+        n_failed += failed("subsampled GraphML tree", ok, ok, 1);
+    }
+
+    const uint depth = 100000;
+    std::vector<uint> infectors(depth);
+    std::vector<double> times(depth);
+    for (uint id = 0; id < depth; ++id)
+    {
+        infectors[id] = (id == 0) ? NO_INFECTOR : id - 1;
+        times[id] = id;
+    }
+    write_line_list(path, infectors, times, times);
+    {
+        LineListReader lines(path);
+        std::ostringstream chain;
+        TreeWriter(lines).newick(chain);
+        std::string newick = chain.str();
+        long n_open = std::count(newick.begin(), newick.end(), '(');
+        bool ok = newick.compare(depth - 1, 9, "99999:1)9") == 0 && newick.size() > 4
+                  && newick.compare(newick.size() - 4, 4, ")0;\n") == 0;
+        n_failed += failed("deep Newick tree", ok && n_open == depth - 1, n_open, depth - 1);
+    }
+    std::remove(path.c_str());
+    return n_failed;
+}
+
+// A run stops at its first output step once its token, or that of the batch, expires.
+int check_cancel()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    CancelToken batch, past(0.);
+    CancelToken simulation(INFINITY, &batch);
+    batch.cancel();
+    std::mt19937_64 prng(2);
+    Outbreak<std::mt19937_64, TrackCounts, Cancellable<Silent>, StateCounts> cancelled(prng, params, NULL,
+                                                                                        Cancellable<Silent>(simulation));
+    Outbreak<std::mt19937_64, TrackCounts, Cancellable<Silent>, StateCounts> late(prng, params, NULL,
+                                                                                   Cancellable<Silent>(past));
+    Ensemble ensemble(prng, params, std::vector<double>(4, params.infect_delta), &batch);
+    bool ok = ensemble.cancelled && (ensemble.counters.rightCols(ensemble.counters.cols() - 1).array() == 0).all();
+    return failed("output steps when cancelled", cancelled.finished && cancelled.output_counter == 1,
+                  cancelled.output_counter, 1)
+           + failed("ensemble output steps when cancelled", ok, ensemble.cancelled, 1)
+           + failed("output steps past the deadline", late.finished && late.output_counter == 1, late.output_counter, 1);
+}
+
+// Return the mean weekly growth of the cumulative infections from output step `first` to
+// `last`, over the runs from seeds 1 to n_runs that reached 1000 infections by `first`.
+double mean_growth(params_struct params, uint first, uint last, uint n_runs)
+{
+    params.max_time = params.output_interval * (last + 1);
+    params.max_infected = UINT_MAX;
+    double sum = 0.;
+    uint n = 0;
+    for (uint seed = 1; seed <= n_runs; ++seed)
+    {
+        std::mt19937_64 prng(seed);
+        Outbreak<std::mt19937_64, TrackCounts, Silent, StateCounts> ob(prng, params);
+        double from = ob.counters.row(first).cast<double>().sum();
+        double to = ob.counters.row(last).cast<double>().sum();
+        if (from >= 1000.)
+        {
+            sum += log(to / from) / (last - first);
+            n++;
+        }
+    }
+    return sum / n;
+}
+
+// Return the estimate of R0 of a run with the tree, rescanning it as getR0 did before the
+// estimate was maintained: the reported infectees of infectors past the infectious period.
+template <class Outbreak>
+float rescanned_R0(Outbreak &ob)
+{
+    std::vector<Infectee *> infected = ob.getInfected();
+    std::vector<bool> past(infected.size(), false);
+    for (std::vector<Infectee *>::iterator it = infected.begin(); it != infected.end(); ++it)
+        past[(*it)->get_id()] = std::find(States, States + N_STATES, (*it)->status()) - States > 3;
+    int n_reported = 0, n_infectors = std::count(past.begin(), past.end(), true);
+    for (std::vector<Infectee *>::iterator it = infected.begin(); it != infected.end(); ++it)
+        if ((*it)->get_infector_id() != NO_INFECTOR && past[(*it)->get_infector_id()] && (*it)->is_reported())
+            n_reported++;
+    return (float)n_reported / n_infectors;
+}
+
+// The estimate of R0 maintained during a run equals a rescan of the tree at its end.
+bool check_R0_estimate()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 2000;
+    uint n_mismatches = 0, n_estimates = 0;
+    for (uint seed = 0; seed < 100; ++seed)
+    {
+        std::mt19937_64 prng(seed);
+        Outbreak<std::mt19937_64, TrackTree, Silent, ReportedCounts> ob(prng, params);
+        float estimate = ob.getR0(), rescanned = rescanned_R0(ob);
+        n_estimates += !std::isnan(estimate);
+        n_mismatches += !(estimate == rescanned || (std::isnan(estimate) && std::isnan(rescanned)));
+    }
+    return failed("R0 estimate as rescanned", n_mismatches == 0 && n_estimates > 0, n_mismatches, 0);
+}
+
+// The case reproduction numbers are the infectees per infected of each output interval in
+// the tree, and the histograms count each infectee with an infector once.
+bool check_case_estimates()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 5000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackTree, Silent, ReportedCounts> ob(prng, params);
+    std::vector<Infectee *> infected = ob.getInfected();
+    uint n_output = ob.getCounters().rows();
+
+    std::vector<uint> interval(infected.size());
+    Eigen::VectorXd n_infected = Eigen::VectorXd::Zero(n_output), n_infectees = Eigen::VectorXd::Zero(n_output);
+    for (std::vector<Infectee *>::iterator it = infected.begin(); it != infected.end(); ++it)
+    {
+        interval[(*it)->get_id()] = std::min<double>(std::floor((*it)->time_infected() / params.output_interval),
+                                                     n_output - 1.);
+        n_infected[interval[(*it)->get_id()]]++;
+    }
+    int n_with_infector = 0;
+    for (std::vector<Infectee *>::iterator it = infected.begin(); it != infected.end(); ++it)
+    {
+        if ((*it)->get_infector_id() == NO_INFECTOR)
+            continue;
+        n_infectees[interval[(*it)->get_infector_id()]]++;
+        n_with_infector++;
+    }
+
+    Eigen::VectorXd case_R = ob.case_estimates.case_R();
+    bool ok = n_with_infector > 0;
+    for (uint i = 0; i < n_output; ++i)
+        ok = ok && ((n_infected[i] > 0) ? case_R[i] == n_infectees[i] / n_infected[i] : std::isnan(case_R[i]));
+    ok = ok && ob.case_estimates.generation_intervals.sum() == n_with_infector
+         && ob.case_estimates.serial_intervals.sum() == n_with_infector;
+    return failed("case estimates from the tree", ok, ob.case_estimates.generation_intervals.sum(), n_with_infector);
+}
+
+// Generation and serial intervals on a bin edge up to rounding land in the same bin.
+bool check_interval_bins()
+{
+    params_struct params;
+    params.histogram_bin = 0.1;
+    CaseEstimates estimates(params);
+    uint n_bins = estimates.generation_intervals.size();
+    estimates.add(0.3, 0.3, 0., 0.); // 0.3 / 0.1 rounds below 3
+    bool ok = estimates.generation_intervals[3] == 1 && estimates.serial_intervals[n_bins + 3] == 1;
+    return failed("intervals on a bin edge", ok, estimates.serial_intervals[n_bins + 3], 1);
+}
+
+// The compartmental approximation grows at the rate of the individual-based model.
+bool check_hybrid_growth()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 1.7;
+    double individual = mean_growth(params, 24, 32, 40);
+    params.hybrid_threshold = 1000;
+    double hybrid = mean_growth(params, 24, 32, 40);
+    return failed("hybrid growth per week", fabs(hybrid - individual) < 0.04 * individual, hybrid, individual);
+}
+
+// The ensemble has the exploding fraction and the weekly mean reported counts of Outbreak.
+int check_ensemble()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 1.5;
+    params.max_time = 140.;
+    params.max_infected = 2000;
+    const uint n_runs = 4000, n_replicates = 100;
+    uint n_output = lrint(params.max_time / params.output_interval);
+    Eigen::VectorXd outbreak_mean = Eigen::VectorXd::Zero(n_output), ensemble_mean = outbreak_mean;
+    uint outbreak_exploding = 0, ensemble_exploding = 0;
+    std::mt19937_64 prng(1);
+    for (uint i = 0; i < n_runs; ++i)
+    {
+        Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> ob(prng, params);
+        outbreak_mean += ob.counters.col(0).cast<double>() / n_runs;
+        outbreak_exploding += ob.counters.cast<long>().sum() > 10 * n_output;
+    }
+    for (uint i = 0; i < n_runs; i += n_replicates)
+    {
+        Ensemble ensemble(prng, params, std::vector<double>(n_replicates, params.infect_delta));
+        for (uint k = 0; k < n_replicates; ++k)
+        {
+            ensemble_mean += ensemble.counters.row(k).transpose().cast<double>() / n_runs;
+            ensemble_exploding += ensemble.counters.row(k).cast<long>().sum() > 10 * n_output;
+        }
+    }
+
+    bool weeks_ok = true;
+    for (uint t = 0; t < n_output; ++t)
+        if (outbreak_mean[t] >= 1.)
+            weeks_ok = weeks_ok && fabs(ensemble_mean[t] - outbreak_mean[t]) < 0.15 * outbreak_mean[t];
+    double total = outbreak_mean.sum(), ensemble_total = ensemble_mean.sum();
+    return failed("ensemble exploding runs", fabs(1. * ensemble_exploding - outbreak_exploding) < 0.04 * n_runs,
+                  ensemble_exploding, outbreak_exploding)
+           + failed("ensemble mean reported total", weeks_ok && fabs(ensemble_total - total) < 0.1 * total,
+                    ensemble_total, total);
+}
+
+// Ensemble replicates reaching max_infected report zero from then on, and cumulative
+// counts before.
+bool check_ensemble_stopped()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    params.max_infected = 500;
+    std::mt19937_64 prng(1);
+    Ensemble ensemble(prng, params, std::vector<double>(50, params.infect_delta));
+    uint n_stopped = 0;
+    bool ok = true;
+    for (uint k = 0; k < 50; ++k)
+    {
+        if (ensemble.n_infected[k] <= params.max_infected)
+            continue;
+        n_stopped++;
+        Eigen::VectorXi row = ensemble.counters.row(k);
+        uint t = 1;
+        while (t < row.size() && row[t] >= row[t - 1])
+            t++;
+        ok = ok && t < row.size() && (row.tail(row.size() - t).array() == 0).all();
+    }
+    return failed("ensemble rows zero after max_infected", ok && n_stopped > 0, n_stopped, n_stopped);
+}
+
+// Hybrid runs continue past max_infected once in the compartments, to the end of the series.
+bool check_hybrid_unlimited()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.5;
+    params.hybrid_threshold = 2000;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> ob(prng, params);
+    bool ok = ob.n_infected > params.max_infected && ob.counters(ob.counters.rows() - 1, 0) > 0;
+    return failed("hybrid run to the end beyond max_infected", ok, ob.n_infected, params.max_infected);
+}
+
+// The distance accumulated by DistanceMonitor is that of the counters, also of runs ended
+// before the end of the observed series.
+bool check_distance_monitor()
+{
+    params_struct params;
+    params.infect_delta = 1.;
+    params.max_infected = 2000;
+    uint n_observed = params.max_time / params.output_interval;
+    Eigen::VectorXd observed(n_observed);
+    for (uint i = 0; i < n_observed; ++i)
+        observed[i] = 10. * i;
+    Distance distance(observed);
+
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, DistanceMonitor, ReportedCounts> ob(prng, params, NULL,
+                                                                               DistanceMonitor(distance, 0.));
+    double expected = distance(ob.getCounters().col(0));
+    bool ok = ob.n_infected > params.max_infected && fabs(ob.monitor.value() - expected) < 1e-9 * expected;
+    return failed("distance monitor of a run ended early", ok, ob.monitor.value(), expected);
+}
+
+// The distance of a batch row redrawn until exploding is that of the kept counts only.
+bool check_redrawn_distance()
+{
+    params_struct params;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 1.3;
+    uint n_output = BatchQueue::n_output(params);
+    Distance distance(Eigen::VectorXd::Constant(n_output, 50.));
+    RowMatrixXi output(1, n_output);
+    CancelToken token;
+    Cancellable<DistanceMonitor> monitor(token, DistanceMonitor(distance, 10. * n_output));
+    Progress progress;
+    std::mt19937_64 prng(1); // a seed with runs dying out first
+    bool kept = simulateReported(prng, params, output, 0, NULL, monitor, &progress);
+    double expected = distance(output.row(0).transpose());
+    bool ok = kept && progress.redraws > 0 && fabs(monitor.value() - expected) < 1e-9 * expected;
+    return failed("distance of a redrawn row", ok, monitor.value(), expected);
+}
+
+// Stopping simulations early in rejection ABC keeps the same samples as running them all.
+bool check_abc_early_stopping()
+{
+    params_struct params;
+    params.max_time = 140.;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> observed(prng, params);
+    AbcModel model(params, std::vector<std::string>(1, "R0"), observed.getCounters().col(0));
+    std::vector<Prior> priors(1, Prior("R0", "uniform:1:4"));
+
+    RejectionABC full(model, priors, 100, 0, INFINITY, 1);
+    double threshold = full.distances[full.distances.size() / 4];
+    RejectionABC stopped(model, priors, 100, 0, threshold, 1);
+    uint n_within = 0;
+    while (n_within < full.distances.size() && full.distances[n_within] <= threshold)
+        n_within++;
+    bool ok = stopped.samples.rows() == n_within && stopped.samples == full.samples.topRows(n_within);
+    return failed("rejection ABC samples stopped early", ok, stopped.samples.rows(), n_within);
+}
+
+// ABC-SMC has decreasing thresholds, normalized weights and effective sample sizes within
+// the particles, with the same results for any number of threads.
+bool check_abc_smc()
+{
+    params_struct params;
+    params.max_time = 140.;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> observed(prng, params);
+    std::vector<Prior> priors(1, Prior("R0", "uniform:1:4"));
+    smc_struct settings;
+    settings.n_particles = 40;
+    settings.n_rounds = 4;
+
+    params.n_threads = 1;
+    AbcSMC single(AbcModel(params, std::vector<std::string>(1, "R0"), observed.getCounters().col(0)), priors,
+                  settings, 1);
+    params.n_threads = 4;
+    AbcSMC threaded(AbcModel(params, std::vector<std::string>(1, "R0"), observed.getCounters().col(0)), priors,
+                    settings, 1);
+
+    bool ok = single.thresholds.size() > 1 && std::isinf(single.thresholds[0])
+              && std::abs(single.weights.sum() - 1.) < 1e-12;
+    for (size_t r = 1; r < single.thresholds.size(); ++r)
+        ok = ok && single.thresholds[r] < single.thresholds[r - 1];
+    for (size_t r = 0; r < single.ess.size(); ++r)
+        ok = ok && single.ess[r] <= settings.n_particles * (1. + 1e-12);
+    ok = ok && threaded.particles == single.particles && threaded.weights == single.weights
+         && threaded.distances == single.distances && threaded.thresholds == single.thresholds;
+    return failed("ABC-SMC rounds", ok, single.thresholds.size(), settings.n_rounds);
+}
+
+// Return whether x equals y up to rounding, or both are NaN.
+bool same_stat(double x, double y)
+{
+    return (std::isnan(x) && std::isnan(y)) || std::abs(x - y) <= 1e-9 * std::max(1., std::abs(y));
+}
+
+// Summary statistics of fixed series of counts: all zero, a single week with cases, doubling
+// until stopped, and Fibonacci numbers; ratio as _conseq_ratio1d in Ebola_ELFI_R0.ipynb.
+// Unknown statistics and lags below 1 are refused.
+int check_summaries()
+{
+    RowMatrixXi counts(4, 8);
+    counts << 0, 0, 0, 0, 0, 0, 0, 0,
+              0, 0, 5, 0, 0, 0, 0, 0,
+              1, 2, 4, 8, 16, 32, 0, 0,
+              0, 1, 2, 3, 5, 8, 13, 21;
+    Summaries summaries("counts,total,log_total,peak,growth,ratio:1,ratio:2,acf:1,acf:2", 8);
+    RowMatrixXd stats;
+    summaries.compute(counts, stats);
+    const double nan = std::nan("");
+    RowMatrixXd expected(4, 8);
+    expected << 0, 0., 0, nan, nan, nan, nan, nan,
+                5, std::log(6.), 2, nan, nan, nan, nan, nan,
+                // growth: slope of log(2, 2, 3, 5, 9, 17) over -2.5..2.5; ratio: 16 / 8 = 32 / 16 and 32 / 8
+                32, std::log(33.), 5, 0.449239675188, 2., 4., 0.365110246433, -0.016861219196,
+                // ratio:1 (5 / 3 + 8 / 5 + 13 / 8 + 21 / 13) / 4, ratio:2 (8 / 3 + 13 / 5 + 21 / 8) / 3
+                21, std::log(22.), 7, 0.264378712437, (5. / 3 + 8. / 5 + 13. / 8 + 21. / 13) / 4,
+                (8. / 3 + 13. / 5 + 21. / 8) / 3, 10. / 21, 2. / 21;
+
+    bool ok = summaries.size() == 16 && stats.cols() == 16 && stats.leftCols(8) == counts.cast<double>();
+    uint n_mismatches = 0;
+    for (uint r = 0; r < 4; ++r)
+        for (uint k = 0; k < 8; ++k)
+            n_mismatches += !same_stat(stats(r, 8 + k), expected(r, k));
+    int n_failed = failed("summary statistics", ok && n_mismatches == 0, n_mismatches, 0);
+
+    uint n_refused = 0;
+    for (const char *spec : {"counts,median", "ratio:0", "acf:-1"})
+    {
+        try
+        {
+            Summaries refused(spec, 8);
+        }
+        catch (const std::invalid_argument &)
+        {
+            n_refused++;
+        }
+    }
+    n_failed += failed("summary specs refused", n_refused == 3, n_refused, 3);
+    return n_failed;
+}
+
+// Inference with an expired token stops without simulating.
+bool check_inference_cancelled()
+{
+    params_struct params;
+    params.max_time = 70.;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> observed(prng, params);
+    Eigen::VectorXi counts = observed.getCounters().col(0);
+    AbcModel model(params, std::vector<std::string>(1, "R0"), counts);
+    std::vector<Prior> priors(1, Prior("R0", "uniform:1.5:3"));
+    CancelToken token;
+    token.cancel();
+
+    RejectionABC rejection(model, priors, 1000, 0, INFINITY, 1, &token);
+    smc_struct smc;
+    AbcSMC abc(model, priors, smc, 1, &token);
+    ParticleFilter filter(params, counts, Reporting("binomial:0.8"), 1000, 1, &token);
+    pmcmc_struct pmcmc;
+    pmcmc.reporting = "binomial:0.8";
+    ParticleMCMC chain(params, priors, Eigen::VectorXd::Constant(1, 2.), Eigen::VectorXd::Constant(1, 0.5), counts,
+                       pmcmc, 1, &token);
+    bool ok = rejection.samples.rows() == 0 && abc.thresholds.size() == 1 && std::isnan(filter.log_likelihood)
+              && chain.chain.rows() == 0;
+    return failed("inference cancelled", ok, abc.n_simulations, smc.n_particles);
+}
+
+// Reporting has the binomial and negative binomial log-probabilities.
+bool check_reporting()
+{
+    Reporting binomial("binomial:0.3"), negbinomial("negbinomial:0.5:2");
+    bool ok = close(binomial.log_likelihood(2, 5), std::log(10. * 0.3 * 0.3 * 0.7 * 0.7 * 0.7), 1.)
+              && close(binomial.log_likelihood(5, 5), 5. * std::log(0.3), 1.)
+              && binomial.log_likelihood(6, 5) == -INFINITY && binomial.log_likelihood(0, 0) == 0.;
+    // mean 2 and size 2: (y + 1) / 2^(y + 2)
+    ok = ok && close(negbinomial.log_likelihood(3, 4), std::log(4. / 32.), 1.)
+         && close(negbinomial.log_likelihood(0, 4), std::log(1. / 4.), 1.)
+         && negbinomial.log_likelihood(0, 0) == 0. && negbinomial.log_likelihood(1, 0) == -INFINITY;
+    return failed("reporting log-likelihoods", ok, binomial.log_likelihood(2, 5), std::log(0.3087));
+}
+
+// The particle filter has the same likelihood for any number of threads, and none for
+// counts beyond all particles under binomial reporting. A short particle MCMC stays in
+// the support of the priors.
+int check_particle_filter()
+{
+    params_struct params;
+    params.max_time = 70.;
+    params.infect_delta = params.infect_period_shape * params.infect_period_scale / 2.;
+    std::mt19937_64 prng(2); // a seed with the outbreak taking off
+    Outbreak<std::mt19937_64, TrackCounts, Silent, ReportedCounts> outbreak(prng, params);
+    Eigen::VectorXi observed = (outbreak.getCounters().col(0).cast<double>() * 0.8).cast<int>();
+    Reporting reporting("binomial:0.8");
+    int n_failed = 0;
+
+    params.n_threads = 1;
+    ParticleFilter single(params, observed, reporting, 200, 1);
+    params.n_threads = 4;
+    ParticleFilter threaded(params, observed, reporting, 200, 1);
+    n_failed += failed("particle filter likelihood over threads",
+                       std::isfinite(single.log_likelihood) && threaded.log_likelihood == single.log_likelihood
+                       && threaded.ess == single.ess,
+                       threaded.log_likelihood, single.log_likelihood);
+
+    ParticleFilter beyond(params, Eigen::VectorXi::Constant(observed.size(), 1000000), reporting, 200, 1);
+    n_failed += failed("particle filter of counts beyond the particles", beyond.log_likelihood == -INFINITY,
+                       beyond.log_likelihood, -INFINITY);
+
+    std::vector<Prior> priors(1, Prior("R0", "uniform:1.5:3"));
+    pmcmc_struct settings;
+    settings.n_particles = 50;
+    settings.n_iterations = 20;
+    settings.reporting = "binomial:0.8";
+    ParticleMCMC chain(params, priors, Eigen::VectorXd::Constant(1, 2.), Eigen::VectorXd::Constant(1, 0.5), observed,
+                       settings, 1);
+    bool ok = chain.chain.rows() == settings.n_iterations && (chain.chain.array() >= 1.5).all()
+              && (chain.chain.array() <= 3.).all() && chain.n_accepted <= settings.n_iterations;
+    n_failed += failed("particle MCMC within the priors", ok, chain.chain.minCoeff(), 1.5);
+    return n_failed;
+}
+
+int main()
+{
+    int n_failed = 0;
+    n_failed += check_R0_estimate();
+    n_failed += check_case_estimates();
+    n_failed += check_interval_bins();
+    n_failed += check_hybrid_growth();
+    n_failed += check_hybrid_unlimited();
+    n_failed += check_ensemble();
+    n_failed += check_ensemble_stopped();
+    n_failed += check_distance_monitor();
+    n_failed += check_redrawn_distance();
+    n_failed += check_abc_early_stopping();
+    n_failed += check_abc_smc();
+    n_failed += check_summaries();
+    n_failed += check_reporting();
+    n_failed += check_inference_cancelled();
+    n_failed += check_particle_filter();
+    n_failed += check_kernels();
+    n_failed += check_ziggurats();
+    n_failed += check_gamma_sampler();
+    n_failed += check_threads();
+    n_failed += check_clone<TrackTree>("with the tree");
+    n_failed += check_clone<TrackCounts>("with counts");
+    n_failed += check_checkpoint<TrackTree>("with the tree");
+    n_failed += check_checkpoint<TrackCounts>("with counts");
+    n_failed += check_stepping();
+    n_failed += check_batches();
+    n_failed += check_cancel();
+    n_failed += check_line_list_records();
+    n_failed += check_line_list_reader();
+    n_failed += check_trees();
+    n_failed += check_progress();
+    return n_failed;
+}
@@ -0,0 +1,84 @@
+// Contains the implementation for a pool of worker threads.
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(uint n_threads) : task(NULL), n_tasks(0), next(0), n_busy(0), generation(0), stopping(false)
+{
+    for (uint i = 1; i < n_threads; ++i)
+        this->workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::vector<std::thread>::iterator it = this->workers.begin(); it != this->workers.end(); ++it)
+        it->join();
+}
+
+uint ThreadPool::size() const
+{
+    // Return the number of threads incl. the caller.
+    return this->workers.size() + 1;
+}
+
+void ThreadPool::parallel_for(uint n_tasks, const std::function<void(uint)> &task)
+{
+    // Run task(0), ..., task(n_tasks - 1) in any order and return when all are done.
+    if (this->workers.empty())
+    {
+        for (uint i = 0; i < n_tasks; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->task = &task;
+        this->n_tasks = n_tasks;
+        this->next = 0;
+        this->generation++;
+    }
+    this->wake.notify_all();
+    this->run_tasks();
+
+    // all tasks are taken, those of the workers are done once they are idle
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (this->n_busy > 0)
+        this->done.wait(lock);
+    this->task = NULL;
+}
+
+void ThreadPool::run_tasks()
+{
+    // Run tasks until none is left.
+    for (uint i = this->next++; i < this->n_tasks; i = this->next++)
+        (*this->task)(i);
+}
+
+void ThreadPool::work()
+{
+    // Loop of a worker thread: join each parallel_for that still has tasks left.
+    uint seen = 0;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true)
+    {
+        while (!this->stopping && this->generation == seen)
+            this->wake.wait(lock);
+        if (this->stopping)
+            return;
+        seen = this->generation;
+        if (this->next >= this->n_tasks)
+            continue;
+
+        this->n_busy++;
+        lock.unlock();
+        this->run_tasks();
+        lock.lock();
+        if (--this->n_busy == 0)
+            this->done.notify_all();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef unsigned int uint;
+
+// Persistent worker threads for running numbered tasks in parallel. The calling thread
+// takes part in the work, so a pool of one thread runs everything in the caller.
+class ThreadPool
+{
+    public:
+        ThreadPool(uint n_threads);
+        ~ThreadPool();
+
+        uint size() const;                 // Return the number of threads incl. the caller.
+        void parallel_for(uint n_tasks, const std::function<void(uint)> &task); // Run task(0), ..., task(n_tasks - 1).
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;      // signals workers of new tasks or stopping
+        std::condition_variable done;      // signals the caller of idle workers
+        const std::function<void(uint)> *task; // current tasks, valid during parallel_for
+        uint n_tasks;
+        std::atomic<uint> next;            // next task to be taken
+        uint n_busy;                       // workers running tasks
+        uint generation;                   // number of parallel_for calls so far
+        bool stopping;
+
+        void work();                       // Loop of a worker thread.
+        void run_tasks();                  // Run tasks until none is left.
+};
+
+#endif
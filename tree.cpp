@@ -0,0 +1,159 @@
+// Contains the implementation for writing transmission trees.
+
+#include <iomanip>
+#include <random>
+
+#include "tree.hpp"
+
+TreeWriter::TreeWriter(const LineListReader &lines, double p_tips, double time, uint seed)
+    : lines(lines), shown(lines.size(), DROPPED), n_kept(lines.size(), 0), sampled(0)
+{
+    // Sample in order of id, then mark the kept individuals from the last to the first,
+    // as infectors precede their infectees.
+    std::mt19937_64 prng(seed);
+    uint64_t n = lines.size();
+    for (uint64_t id = 0; id < n; ++id)
+    {
+        const LineListRecord &record = lines[id];
+        double report_time = (record.symptom == 1) ? record.end_times[0] : record.end_times[1];
+        if (report_time <= time && (p_tips >= 1. || uniform01(prng) < p_tips))
+        {
+            this->shown[id] = SHOWN;
+            this->sampled++;
+        }
+    }
+
+    for (uint64_t id = n; id-- > 0;)
+    {
+        if (this->shown[id] == DROPPED && this->n_kept[id] > 0)
+            this->shown[id] = (this->n_kept[id] > 1) ? SHOWN : JOINED;
+        if (this->shown[id] != DROPPED && !this->is_root(id))
+        {
+            uint8_t &parent_kept = this->n_kept[lines[id].infector];
+            parent_kept = std::min(parent_kept + 1, 2);
+        }
+    }
+}
+
+uint64_t TreeWriter::n_sampled() const
+{
+    // Return the number of sampled individuals.
+    return this->sampled;
+}
+
+bool TreeWriter::is_root(uint32_t id) const
+{
+    // Return whether `id` has no infector (in the line list).
+    return this->lines[id].infector >= this->lines.size();
+}
+
+uint32_t TreeWriter::joined_end(uint32_t id) const
+{
+    // Return the shown descendant where a chain of JOINED individuals from `id` ends.
+    while (this->shown[id] == JOINED)
+    {
+        const uint32_t *child = this->lines.children_begin(id);
+        while (this->shown[*child] == DROPPED)
+            ++child;
+        id = *child;
+    }
+    return id;
+}
+
+uint32_t TreeWriter::shown_parent(uint32_t id) const
+{
+    // Return the nearest shown ancestor of `id` or NO_INFECTOR.
+    do
+    {
+        if (this->is_root(id))
+            return NO_INFECTOR;
+        id = this->lines[id].infector;
+    } while (this->shown[id] != SHOWN);
+    return id;
+}
+
+void TreeWriter::newick(std::ostream &os) const
+{
+    // Write one Newick tree per root, depth first with an explicit stack.
+    struct Frame
+    {
+        uint32_t id;
+        const uint32_t *next;              // next infectee to visit
+        bool first;                        // whether no infectee is written yet
+    };
+    std::vector<Frame> stack;
+    std::streamsize precision = os.precision(10);
+
+    for (uint64_t root = 0; root < this->lines.size(); ++root)
+    {
+        if (!this->is_root(root) || this->shown[root] == DROPPED)
+            continue;
+
+        uint32_t id = this->joined_end(root);
+        if (this->n_kept[id] > 0)
+        {
+            os << '(';
+            stack.push_back(Frame{id, this->lines.children_begin(id), true});
+        }
+        else
+            os << id;
+
+        while (!stack.empty())
+        {
+            Frame &frame = stack.back();
+            const uint32_t *end = this->lines.children_end(frame.id);
+            while (frame.next != end && this->shown[*frame.next] == DROPPED)
+                ++frame.next;
+
+            uint32_t parent = frame.id;
+            if (frame.next == end) // close the subtree
+            {
+                stack.pop_back();
+                os << ')' << parent;
+                if (!stack.empty())
+                    os << ':' << this->lines[parent].infection_time - this->lines[stack.back().id].infection_time;
+                continue;
+            }
+
+            if (!frame.first)
+                os << ',';
+            frame.first = false;
+            uint32_t child = this->joined_end(*frame.next++);
+            if (this->n_kept[child] > 0) // open a subtree, invalidating frame
+            {
+                os << '(';
+                stack.push_back(Frame{child, this->lines.children_begin(child), true});
+            }
+            else
+                os << child << ':' << this->lines[child].infection_time - this->lines[parent].infection_time;
+        }
+        os << ";\n";
+    }
+    os.precision(precision);
+}
+
+void TreeWriter::graphml(std::ostream &os) const
+{
+    // Write a GraphML graph of the shown individuals, edges pointing to the infected.
+    std::streamsize precision = os.precision(10);
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+       << "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+       << "  <key id=\"t\" for=\"node\" attr.name=\"infection_time\" attr.type=\"double\"/>\n"
+       << "  <key id=\"r\" for=\"node\" attr.name=\"report_time\" attr.type=\"double\"/>\n"
+       << "  <graph id=\"transmission\" edgedefault=\"directed\">\n";
+
+    for (uint64_t id = 0; id < this->lines.size(); ++id)
+    {
+        if (this->shown[id] != SHOWN)
+            continue;
+        const LineListRecord &record = this->lines[id];
+        double report_time = (record.symptom == 1) ? record.end_times[0] : record.end_times[1];
+        os << "    <node id=\"n" << id << "\"><data key=\"t\">" << record.infection_time
+           << "</data><data key=\"r\">" << report_time << "</data></node>\n";
+        uint32_t parent = this->shown_parent(id);
+        if (parent != NO_INFECTOR)
+            os << "    <edge source=\"n" << parent << "\" target=\"n" << id << "\"/>\n";
+    }
+    os << "  </graph>\n</graphml>\n";
+    os.precision(precision);
+}
@@ -0,0 +1,50 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <cmath>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+#include "linelist.hpp"
+
+// Writes the transmission tree of a line list (see linelist.hpp) as Newick or GraphML.
+// Each individual is a node labelled by its id, the branch to it being as long as the
+// time from the infection of its infector to its own. Individuals without infector are
+// the roots of separate trees.
+//
+// Tips can be subsampled: each individual reported by `time` is sampled with probability
+// `p_tips`, and only sampled individuals and their ancestors are kept. Unsampled ancestors
+// with a single kept infectee are left out, joining the branches around them. By default,
+// everyone is sampled, i.e. the whole tree is written.
+//
+// The writers stream from the records without recursion, keeping a few bytes per
+// individual and a stack as deep as the tree.
+class TreeWriter
+{
+    public:
+        TreeWriter(const LineListReader &lines, double p_tips = 1., double time = INFINITY, uint seed = 0);
+
+        void newick(std::ostream &os) const;  // Write one Newick tree per root.
+        void graphml(std::ostream &os) const; // Write a GraphML graph.
+        uint64_t n_sampled() const;        // Return the number of sampled individuals.
+
+    private:
+        enum Shown : uint8_t
+        {
+            DROPPED,                       // neither sampled nor an ancestor of a sampled individual
+            SHOWN,                         // sampled or ancestor with several kept infectees
+            JOINED                         // ancestor with a single kept infectee, left out
+        };
+
+        const LineListReader &lines;
+        std::vector<uint8_t> shown;        // Shown of each individual
+        std::vector<uint8_t> n_kept;       // kept infectees of each individual, saturating at 2
+        uint64_t sampled;
+
+        bool is_root(uint32_t id) const;   // Return whether `id` has no infector.
+        uint32_t joined_end(uint32_t id) const; // Return the shown descendant where a JOINED chain ends.
+        uint32_t shown_parent(uint32_t id) const; // Return the nearest shown ancestor or NO_INFECTOR.
+};
+
+#endif